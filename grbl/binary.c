@@ -0,0 +1,114 @@
+/*
+  binary.c - 二进制块流式传输
+  Grbl的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+#include "grbl.h"
+
+#ifdef BINARY_STREAMING
+
+#define BINARY_STATE_NAK_SENT bit(0) // 已发送NAK，等待重发，期间不再重复发送
+
+static uint8_t binary_next_seq; // 期望的帧序号
+static uint8_t binary_state;
+
+
+void binary_reset()
+{
+  binary_next_seq = 0;
+  binary_state = 0;
+}
+
+
+// CRC-16/CCITT，多项式0x1021，初值0xFFFF，不反转。
+static uint16_t binary_crc16(uint8_t *data, uint8_t length)
+{
+  uint16_t crc = 0xFFFF;
+  uint8_t idx;
+  while (length--) {
+    crc ^= (uint16_t)(*data++) << 8;
+    for (idx=0; idx<8; idx++) {
+      if (crc & 0x8000) { crc = (crc << 1) ^ 0x1021; }
+      else { crc <<= 1; }
+    }
+  }
+  return(crc);
+}
+
+
+// 执行一个已通过校验的帧。与gc_execute_line()中G0/G1的最后一步相同，只是目标已经是机器坐标。
+static uint8_t binary_execute_motion(uint8_t *frame)
+{
+  // 与G代码行相同，警报或点动状态下阻塞。
+  if (sys.state & (STATE_ALARM | STATE_JOG)) { return(STATUS_SYSTEM_GC_LOCK); }
+
+  plan_line_data_t plan_data;
+  plan_line_data_t *pl_data = &plan_data;
+  memset(pl_data, 0, sizeof(plan_line_data_t));
+
+  float target[N_AXIS];
+  float spindle_speed;
+  uint8_t flags = frame[1];
+  #ifdef USE_LINE_NUMBERS
+    memcpy(&pl_data->line_number, &frame[2], sizeof(int32_t));
+  #endif
+  memcpy(target, &frame[6], sizeof(target));
+  memcpy(&pl_data->feed_rate, &frame[6+4*N_AXIS], sizeof(float));
+  memcpy(&spindle_speed, &frame[10+4*N_AXIS], sizeof(float));
+
+  if (flags & BINARY_FLAG_RAPID) {
+    pl_data->condition |= PL_COND_FLAG_RAPID_MOTION;
+  } else if (!(pl_data->feed_rate > 0.0)) {
+    return(STATUS_GCODE_UNDEFINED_FEED_RATE);
+  }
+  // 激光模式下每个直线进给块可以有自己的功率，快速移动的功率为零，与G代码相同。
+  // 非激光模式下改变主轴速度需要同步，仍然由G代码的S字完成。
+  if (bit_isfalse(settings.flags,BITFLAG_LASER_MODE)) { pl_data->spindle_speed = gc_state.spindle_speed; }
+  else if (!(flags & BINARY_FLAG_RAPID)) { pl_data->spindle_speed = spindle_speed; }
+  pl_data->condition |= (gc_state.modal.spindle | gc_state.modal.coolant);
+
+  mc_line(target, pl_data);
+  // 保持G代码解析器的位置与规划器一致，之后的G代码行从这里继续。
+  memcpy(gc_state.position, target, sizeof(target));
+  return(STATUS_OK);
+}
+
+
+void binary_execute_block()
+{
+  uint8_t frame[BINARY_FRAME_SIZE];
+  uint8_t idx = 0;
+
+  // 起始字节已经在缓冲区中，帧的其余部分通常也已经到达。注：数据中可能有0xFF，不能用SERIAL_NO_DATA判断。
+  while (idx < BINARY_FRAME_SIZE) {
+    if (serial_get_rx_buffer_count()) {
+      frame[idx++] = serial_read();
+    } else {
+      protocol_execute_realtime(); // 等待期间继续处理实时命令和段准备
+      if (sys.abort) { return; }
+    }
+  }
+
+  uint16_t crc;
+  memcpy(&crc, &frame[BINARY_PAYLOAD_SIZE], sizeof(uint16_t));
+  if ((binary_crc16(frame, BINARY_PAYLOAD_SIZE) != crc) || (frame[0] != binary_next_seq)) {
+    // 回退N帧：只对第一个错误帧发送NAK，之后的帧都丢弃，直到上位机从期望的序号重发。
+    if (bit_isfalse(binary_state,BINARY_STATE_NAK_SENT)) {
+      report_binary_nak(binary_next_seq);
+      binary_state |= BINARY_STATE_NAK_SENT;
+    }
+    return;
+  }
+  binary_state &= ~BINARY_STATE_NAK_SENT;
+  binary_next_seq++;
+
+  report_binary_ack(frame[0], binary_execute_motion(frame));
+}
+
+#endif
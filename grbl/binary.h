@@ -0,0 +1,47 @@
+/*
+  binary.h - 二进制块流式传输
+  Grbl的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+#ifndef binary_h
+#define binary_h
+
+/*
+  帧格式（多字节值均为小端，浮点数为IEEE 754单精度，与AVR相同）：
+
+    CMD_BINARY_BLOCK   起始字节，由串口接收中断识别，之后的BINARY_FRAME_SIZE个字节原样写入接收缓冲区
+    uint8_t  seq       帧序号，复位后从0开始，每帧加1，255之后回到0
+    uint8_t  flags     BINARY_FLAG_RAPID置位时为快速移动(G0)，否则为直线进给(G1)
+    int32_t  line      行号，在状态报告的Ln字段中显示
+    float    target[N_AXIS]  机器坐标系中的绝对目标位置，单位毫米。上位机负责工作坐标偏移和单位换算。
+    float    feed      进给速度，毫米/分钟。快速移动时忽略。
+    float    spindle   主轴速度。只在激光模式的直线进给中使用，其他情况沿用G代码的S值。
+    uint16_t crc       从seq到spindle的CRC-16/CCITT（多项式0x1021，初值0xFFFF）
+
+  应答（窗口式，回退N帧）：
+    [ACK:seq]          该帧及之前的帧已从接收缓冲区取走并执行
+    [ACK:seq,code]     该帧已取走但被拒绝，code与'error:'相同，上位机继续发送后面的帧
+    [NAK:seq]          CRC错误或序号不连续。seq是期望的序号，在收到它之前的帧都被丢弃，上位机应从seq开始重发
+
+  上位机最多可以有RX_BUFFER_SIZE/(BINARY_FRAME_SIZE+1)个未应答的帧，默认为4帧。
+  接收缓冲区放不下整帧时整帧丢弃，下一帧按序号不连续发送NAK。最后一帧被丢弃时没有应答，上位机应超时重发。
+*/
+
+#define BINARY_FLAG_RAPID bit(0)
+
+#define BINARY_PAYLOAD_SIZE (2+4+4*N_AXIS+4+4) // seq到spindle
+#define BINARY_FRAME_SIZE (BINARY_PAYLOAD_SIZE+2) // 起始字节之后的字节数，含CRC
+
+//复位时调用。期望的帧序号回到0。
+void binary_reset();
+
+//主循环读到CMD_BINARY_BLOCK后调用。从接收缓冲区读取一帧，校验并执行，然后发送应答。
+void binary_execute_block();
+
+#endif
@@ -51,6 +51,8 @@
 #define CMD_SAFETY_DOOR 0x84
 #define CMD_JOG_CANCEL  0x85
 #define CMD_DEBUG_REPORT 0x86//仅当启用调试时，才会以“{}”大括号发送调试报告。
+#define CMD_ISR_PROFILE_REPORT 0x87//仅当启用ISR_PROFILE时，打印中断执行时间统计。
+#define CMD_BINARY_BLOCK 0x88//仅当启用BINARY_STREAMING时，表示一个二进制块帧的开始。
 #define CMD_FEED_OVR_RESET 0x90//将进给覆盖值恢复为100%。
 #define CMD_FEED_OVR_COARSE_PLUS 0x91
 #define CMD_FEED_OVR_COARSE_MINUS 0x92
@@ -200,6 +202,13 @@
 //启用用于调试目的的代码。不适用于一般用途。
 // #define DEBUG // 取消注释以启用。默认禁用。
 
+//启用中断执行时间分析。用定时器1计数器记录步进中断（分为脉冲输出、段装载和Bresenham三部分）和串口接收中断的
+//最短/平均/最长CPU周期数，以及步进中断总时间的直方图，用来判断离30kHz步进频率上限（每步533个周期）还有多少余量。
+//用'$P'命令打印并清零，或随时发送CMD_ISR_PROFILE_REPORT实时命令打印而不清零。
+//注：测量本身会让每次中断多出几十个周期，只在调试时启用。不启用AMASS时慢速段的读数按定时器1的8或64分频量化；
+//嵌套的串口接收中断时间从步进中断中减去，但中断进出和步进脉冲复位中断的几十个周期仍计入步进中断。
+// #define ISR_PROFILE // 取消注释以启用。默认禁用。
+
 //配置快速、进给和主轴覆盖设置。这些值定义了允许的最大和最小覆盖值以及每个接收命令的粗略增量和精细增量。
 //请注意以下各定义说明中的允许值。
 #define DEFAULT_FEED_OVERRIDE           100// 100%. 不要更改此值。
@@ -251,9 +260,42 @@
 //增加此值时，段缓冲区中存储的总时间会减少，反之亦然。确保增加/减少步长段缓冲区，以应对这些变化。
 #define ACCELERATION_TICKS_PER_SECOND 100
 
+//启用S形（限制加加速度）速度剖面。默认的梯形剖面在斜坡的起点和终点加速度突变，容易激起龙门的振动。
+//启用后，段准备把每个加速和减速斜坡的速度按3x^2-2x^3的S形曲线变化，斜坡的时间和距离与梯形相同，
+//加速度在两端从零开始连续变化，中点达到平均值的1.5倍。为了不超过设置，规划器按$120-$122的2/3计算加速度，
+//也就是说$120-$122变成峰值加速度。通常可以把它们设置得比梯形剖面时高，以换取更短的加工时间和更小的振动。
+//注：每个块的斜坡单独成形。短线段程序中一个斜坡通常只有一两个段，几乎不受影响。块中途重新计算剖面时斜坡从当前加速度继续，
+//只有继承当前加速度会使峰值超过设置时（例如加速中进给保持）才从零开始，此时仍有加速度突变。
+// #define S_CURVE_PROFILE // 默认禁用。取消注释以启用。
+
+//用定点数进行段准备。st_prep_buffer()每生成一段都要做斜坡积分和步进速率计算，在没有浮点硬件的AVR上，
+//浮点加法、乘法、除法和ceil()占了段准备的大部分时间。启用后距离以1/256步、时间以1/256段、速度以1/65536步每段表示，
+//整段的积分只用整数运算，除法只在斜坡结点和计算步进速率时各一次。块的速度剖面仍然用浮点数计算，每个块只算一次。
+//每个块的总步数与浮点版本完全相同，段的速率只有舍入误差。较高的ACCELERATION_TICKS_PER_SECOND时效果更明显。
+//注：单个块的步数不能超过2^24（与浮点数的精度限制相同）。不能与S_CURVE_PROFILE同时使用。
+// #define ST_PREP_FIXED_POINT // 默认禁用。取消注释以启用。
+
+//自适应段时间。默认每段的时间固定为1/ACCELERATION_TICKS_PER_SECOND。启用后段准备根据当前步进速率选择段时间：
+//每段的步数少于ADAPTIVE_SEGMENT_MIN_STEPS时加倍（不足一半时变为4倍），慢速运动用更少的段和更少的计算填满段缓冲区；
+//在加速或减速斜坡上每段的步数多于ADAPTIVE_SEGMENT_MAX_STEPS，并且段缓冲区至少半满时减半，高速时速度更新更细。
+//AMASS级别仍然按每段的步进速率选择，不受影响。默认的上限等于AMASS第1级的截止频率，只有不用AMASS的速率才会缩短段。
+//注：慢速时段更长，进给保持和覆盖的响应会相应推迟几个段的时间。
+// #define ADAPTIVE_SEGMENT_TIME // 默认禁用。取消注释以启用。
+#define ADAPTIVE_SEGMENT_MIN_STEPS 4 // (步/段) 以ACCELERATION_TICKS_PER_SECOND的段时间计
+#define ADAPTIVE_SEGMENT_MAX_STEPS (8000/ACCELERATION_TICKS_PER_SECOND) // (步/段) 8kHz
+
 //自适应多轴步进平滑（AMASS）是一种高级功能，它实现了其名称所暗示的多轴运动的步进平滑。此功能可平滑运动，尤其是在10kHz以下的低阶跃频率下，多轴运动轴之间的混叠可能会导致可听噪音并震动机器。在更低的阶跃频率下，AMASS可以适应并提供更好的阶跃平滑。见步进电机。c获取有关AMASS系统工作的更多详细信息。
 #define ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING  //默认启用。注释后禁用
 
+//AMASS运行时截止频率。AMASS增加到6级，第1级的截止频率由$38（Hz）设置，使用的最高级别由$39设置，调整平滑程度不必重新烧写固件。
+//每高一级截止频率减半，所以中断频率总是低于第1级截止频率的两倍，$38不能超过15000。级别越高低速多轴运动越平滑，
+//但最低步进速率是F_CPU/2^(16+$39)，$39太小时很慢的运动会被加速。块的步数按最高级别左移6位，Bresenham计数器
+//最大是步数的两倍，所以单个块必须少于2^25步，更长的直线由运动控制拆成几个块。
+//需要启用ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING。改变设置结构的大小，启用后第一次启动会恢复默认设置。
+// #define AMASS_RUNTIME_CUTOFFS // 默认禁用。取消注释以启用。
+#define DEFAULT_AMASS_CUTOFF 8000 // $38 (Hz) 与AMASS_LEVEL1相同
+#define DEFAULT_AMASS_MAX_LEVEL 3 // $39 与MAX_AMASS_LEVEL相同
+
 //设置允许写入Grbl设置的最大步进速率。此选项启用设置模块中的错误检查，以防止设置值超过此限制。最大步进速率严格受CPU速度的限制，如果使用除16MHz运行的AVR以外的其他设备，则会发生变化。
 //注意：现在禁用，如果闪存空间允许，将启用。
 // #define MAX_STEP_RATE_HZ 30000 // Hz
@@ -312,6 +354,13 @@
 //如果正常操作绝对需要串行写入缓冲区，则应大大增加串行写入缓冲区，以帮助最小化串行写入协议中的传输等待。
 // #define REPORT_ECHO_LINE_RECEIVED // 默认禁用。取消注释以启用。
 
+//启用接收缓冲区可用空间推送。主程序取走数据后，接收缓冲区的可用空间比上次推送以来的最低点多出RX_CREDIT_REPORT_STEP时，
+//Grbl就主动发送一次“[RX:可用字节数]”，上位机不必用'?'轮询状态报告中的Bf字段，就能按字符计数把接收缓冲区一直填满。
+//可用空间减少时不推送，因为那是上位机发送数据造成的。
+//注：推送的消息会夹在'ok'之间，只有能识别它的上位机才应启用。
+// #define REPORT_RX_CREDIT // 默认禁用。取消注释以启用。
+#define RX_CREDIT_REPORT_STEP 32 // 推送间隔，字节(1-RX_BUFFER_SIZE)。越小推送越频繁。
+
 // 最小规划器连接速度。 设置规划器计划在每个缓冲区块连接处设置的默认最小连接速度，但从缓冲区的剩余部分开始和结束部分（始终为零）除外。
 //该值控制机器通过交叉点的速度，而不考虑加速度限制或相邻块线移动方向之间的角度。这对于那些无法容忍刀具在交点处短暂停留的机器（例如 3D 打印机或激光切割机）很有用。
 //如果使用，该值不应远大于零或机器工作所需的最小值。
@@ -326,6 +375,20 @@
 //若弧生成的准确性存在问题，则该参数可能会减小，若弧执行因太多trig计算而陷入困境，则该参数可能会增大。
 #define N_ARC_CORRECTION 12 // Integer (1-255)
 
+//批量圆弧生成。默认情况下mc_arc()每生成一个弦段就调用mc_line()，规划器每次都完整地重新规划，
+//并且每N_ARC_CORRECTION段用sin()和cos()精确校正一次。启用后mc_arc()先等到规划器有ARC_BATCH_SEGMENTS个空位，
+//再连续加入整批弦段，批内不重新规划，整批加入后只规划一次。
+//注意：等待空位时前瞻的块数少了ARC_BATCH_SEGMENTS-1个，短弦段圆弧可能稍慢。值越大，规划的工作量越少，但前瞻越短。
+//校正改为每N_ARC_CORRECTION段把半径向量的长度拉回到初始半径（一步牛顿迭代，只有乘法），不再调用三角函数。
+//小角度近似的角度误差远小于半径误差，而且最后一段总是精确到达终点。
+// #define ARC_BATCH_SEGMENTS 4 // 默认禁用。取消注释以启用。(2-BLOCK_BUFFER_SIZE-1)
+
+//原生圆弧块。启用后G2/G3整个圆弧只占用一个规划器块，不再按$12圆弧公差分成许多弦段，前瞻可以看得更远。
+//段准备按弧长推进，每段实际执行到圆弧上精确位置的一条短弦（每段约1/ACCELERATION_TICKS_PER_SECOND秒），弦误差远小于$12。
+//圆弧的速度受向心加速度限制，结点按起点和终点的切线计算。启用软限位时圆弧仍然分段，以便检查每个弦段的终点。
+//注意：每个规划器块增加19字节内存，328p上可能需要减小BLOCK_BUFFER_SIZE。每段要计算一次sin()和cos()。不能与ST_PREP_FIXED_POINT或COREXY同时启用。
+// #define NATIVE_ARC_BLOCKS // 默认禁用。取消注释以启用。
+
 //根据定义，arc G2/3 g代码标准存在问题。当圆弧位于半圆（pi）或全圆（2*pi）时，基于半径的圆弧具有可怕的数值误差。
 //基于偏移的圆弧更精确，但当圆弧为整圆（2*pi）时仍然存在问题。当
 //基于偏移的圆弧被命令为整圆时，该定义解释了浮点问题，但由于数值舍入和精度问题，被解释为机器ε（1.2e-7rad）附近的极小圆弧。
@@ -353,11 +416,37 @@
 
 // #define BLOCK_BUFFER_SIZE 16 // 取消注释以覆盖planner.h中的默认值
 
+//限制每次加入新块时重新规划的块数。默认情况下，planner_recalculate()每次都从缓冲区末尾反向计算到计划指针，
+//在没有块达到最大进入速度的长缓冲区中，每加入一个块就要访问整个缓冲区。启用后最多只重新计算末尾的这么多个块，
+//剩下的部分在主程序等待规划器空位、等待串口数据或同步缓冲区时再完整地重新规划一次。计划始终是安全的，只是暂时可能偏慢。
+//注：主要用于较大的BLOCK_BUFFER_SIZE，缓冲区为16时作用不大。
+// #define PLANNER_RECALCULATE_LIMIT 8 // 默认禁用。取消注释以启用(1-BLOCK_BUFFER_SIZE)。
+
+//合并共线的短线段。CAM程序常把一条直线输出成许多很短的G1，每段占用一个规划器块，缓冲区中的总距离很短，
+//前瞻不足以加速到进给速度。启用后，新线段与缓冲区中最后一个块共线，并且进给、主轴转速和运行条件都相同时，
+//直接延长这个块而不占用新的块。合并后的直线与原来各线段端点的距离不超过这里的公差（毫米）。
+//正在执行的块（缓冲区尾部，已被段准备取出）不会被合并。圆弧、反时间进给和系统运动不合并。
+//注：端点已经取整到步，公差小于一步的距离时，取整误差使大多数线段不能合并。启用USE_LINE_NUMBERS时只合并行号相同的线段。
+// #define PLANNER_MERGE_COLLINEAR 0.005 // 默认禁用。取消注释以启用。公差（毫米）
+
+//支持G64 P路径混合模式。G64 P<公差>之后，相邻两条G1直线的拐角用一段二次贝塞尔曲线代替，
+//曲线离原拐点不超过P（毫米，G20时为英寸），按$12圆弧公差分成弦段送进规划器，拐角不必减速到节点偏差决定的速度。
+//每条直线最多让出一半长度给两端的曲线。G61、G64不带P或M2/M30恢复精确路径（默认）。G64与G4、G10或M56同一行时报错39。
+//注：为了知道下一条直线的方向，最后一条直线留在运动控制中，直到下一个运动、缓冲区同步、'$'命令或规划器将要排空时才送出。
+// #define PATH_BLENDING // 默认禁用。取消注释以启用。
+
 //控制步执行算法和规划器块之间中间步进段缓冲区的大小。
 //每一段都是在一个固定时间内以恒定速度执行的一组步进，该时间由每秒的加速度确定。
 //计算它们时，可精确追踪规划器块速度剖面。
 //此缓冲区的大小控制其他Grbl进程在返回并重新填充此缓冲区之前必须计算和执行的步进执行前置时间，当前为50毫秒的步进移动。
 // #define SEGMENT_BUFFER_SIZE 6 // 取消注释以覆盖stepper.h中的默认值.
+//注：大于255时段缓冲区索引改为16位，主程序读写步进中断也使用的索引要多几个周期。每个段连同它的步进块数据约占25字节RAM，
+//ATmega328p只够几十个段，更大的缓冲区只适用于RAM更大的控制器。
+
+//统计段缓冲区欠载次数。运动还没有结束（段准备还在准备一个块，或者规划器中还有块）时步进中断发现段缓冲区已空，
+//电机会在运动中途停下来，等主程序填充缓冲区后重新启动，这称为欠载。启用后步进中断统计欠载次数，在状态报告中以|Un:次数输出
+//（为0时不输出），用来根据主程序延迟调整SEGMENT_BUFFER_SIZE。进给保持和运动正常结束时缓冲区变空不计入。软复位时清零。
+// #define REPORT_SEGMENT_UNDERRUNS // 默认禁用。取消注释以启用。
 
 //要执行的串行输入流的行缓冲区大小。此外，还控制每个启动块的大小，因为它们都存储为该大小的字符串。
 //确保在settings.h中的定义内存地址处说明可用的EEPROM以及所需启动块的数量。
@@ -378,6 +467,23 @@
 // #define RX_BUFFER_SIZE 128 // (1-254) 取消注释以覆盖serial.h中的默认值
 // #define TX_BUFFER_SIZE 100 // (1-254)
 
+//启用二进制块流式传输。上位机可以把已经解析好的直线运动（机器坐标目标、进给速度、主轴速度和行号）打包成带CRC的
+//定长二进制帧，与普通G代码行混合发送。二进制帧不经过G代码解析，直接用mc_line()送入规划器，
+//并按帧序号窗口应答，上位机不必等待每一行的'ok'，短线段程序也能让规划器保持满载。帧格式和应答见binary.h。
+//注：帧内数据不会被当作实时命令，所以发送实时命令前必须先发完当前帧。
+// #define BINARY_STREAMING // 默认禁用。取消注释以启用。
+
+//在主循环逐字符组装行的同时识别g代码字（字母和数值），数值也随字符到达逐位累积。gc_execute_line()直接使用识别好的字，
+//不再重新扫描行和调用read_float()，缩短流式发送短线段时每行的处理延迟。结果与逐行解析完全相同。
+//注：需要额外约(5*GC_MAX_LINE_WORDS+10)字节的RAM。字数超过GC_MAX_LINE_WORDS的行仍按原来的方法解析。
+// #define STREAMING_TOKENIZER // 默认禁用。取消注释以启用。
+#define GC_MAX_LINE_WORDS 16 // 每行预先识别的最多字数。
+
+//曲面加工等程序的绝大多数行只是在当前G0/G1模态下给出新的X、Y、Z（可以重复G0/G1，也可以带F）。启用后这样的行
+//不再初始化整个解析块、也不经过完整的错误检查，只检查轴字并按当前模态算出目标后直接调用mc_line()。
+//其它任何字、重复的字、G93、点动或可能出错的行仍由完整的解析器处理，结果与完整解析完全相同。
+// #define MODAL_FAST_PATH // 默认禁用。取消注释以启用。
+
 //硬限位开关的简单软件去抖动功能。启用时，监控硬限位开关引脚的中断将使Arduino的看门狗定时器在大约32毫秒的延迟后重新检查限位引脚状态。
 //这有助于解决数控机床硬限位开关错误触发的问题，但无法解决外部电源信号电缆的电气干扰问题。
 //建议首先使用屏蔽连接到地面的屏蔽信号电缆（旧的USB/计算机电缆工作良好，价格便宜），并在低通电路中连接到每个限位引脚。
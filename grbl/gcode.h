@@ -99,6 +99,7 @@
 
  // 模式组G13：控制模式
 #define CONTROL_MODE_EXACT_PATH 0 // G61（默认值：必须为零）
+#define CONTROL_MODE_BLEND 1 // G64
 
  // 模态组M7：主轴控制
 #define SPINDLE_DISABLE 0 // M5（默认值：必须为零）
@@ -180,7 +181,11 @@ typedef struct {
    //  uint8_t cutter_comp;   //  {G40} NOTE: Don't track. Only default supported.
   uint8_t tool_length;      //  {G43.1,G49}
   uint8_t coord_select;     //  {G54,G55,G56,G57,G58,G59}
+  #ifdef PATH_BLENDING
+    uint8_t control;        //  {G61,G64}
+  #else
    //  uint8_t control;       //  {G61} NOTE: Don't track. Only default supported.
+  #endif
   uint8_t program_flow;     //  {M0,M1,M2,M30}
   uint8_t coolant;          //  {M7,M8,M9}
   uint8_t spindle;          //  {M3,M4,M5}
@@ -214,6 +219,9 @@ typedef struct {
   float coord_system[N_AXIS]; // 当前工作坐标系（G54+）。存储机器绝对位置的偏移量，单位为mm。调用时从EEPROM加载。
   float coord_offset[N_AXIS]; // 保留相对于机器零点的G92坐标偏移（工作坐标），单位为mm。非持久性。重置和引导时清除。
   float tool_length_offset; // 启用时跟踪刀具长度偏移值。
+  #ifdef PATH_BLENDING
+    float blend_tolerance; // G64 P的路径混合公差，单位为mm。为零时不混合。
+  #endif
 } parser_state_t;
 extern parser_state_t gc_state;
 
@@ -231,6 +239,17 @@ void gc_init();
  // 执行一个rs275/ngc/g代码块
 uint8_t gc_execute_line(char *line);
 
+#ifdef STREAMING_TOKENIZER
+  // 开始组装新的一行
+  void gc_tokenizer_reset();
+
+  // 加入组装到行中的一个字符（已去掉空白和注释并改成大写）
+  void gc_tokenizer_add(char c);
+
+  // 执行组装好的行，使用逐字符识别好的字。line只用于'$'之外无法预先识别的情况（字太多）。
+  uint8_t gc_execute_tokenized_line(char *line);
+#endif
+
  // 设置g代码解析器的位置。以步为单位。
 void gc_sync_position();
 
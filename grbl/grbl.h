@@ -37,6 +37,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 // Define the Grbl system include files. NOTE: Do not alter organization.
 #include "config.h"
@@ -60,6 +61,7 @@
 #include "spindle_control.h"
 #include "stepper.h"
 #include "jog.h"
+#include "binary.h"
 
 // ---------------------------------------------------------------------------------------
 // COMPILE-TIME ERROR CHECKING OF DEFINE VALUES:
@@ -111,6 +113,59 @@
   #error "Override refresh must be greater than zero."
 #endif
 
+#if defined(ST_PREP_FIXED_POINT) && defined(S_CURVE_PROFILE)
+  #error "ST_PREP_FIXED_POINT and S_CURVE_PROFILE may not be enabled at the same time."
+#endif
+
+#if defined(AMASS_RUNTIME_CUTOFFS) && !defined(ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING)
+  #error "AMASS_RUNTIME_CUTOFFS requires ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING."
+#endif
+
+#if defined(ADAPTIVE_SEGMENT_TIME) && ((ADAPTIVE_SEGMENT_MIN_STEPS < 1) || (ADAPTIVE_SEGMENT_MAX_STEPS <= ADAPTIVE_SEGMENT_MIN_STEPS))
+  #error "ADAPTIVE_SEGMENT_MAX_STEPS must be greater than ADAPTIVE_SEGMENT_MIN_STEPS, which must be at least 1."
+#endif
+
+#if defined(ARC_BATCH_SEGMENTS) && ((ARC_BATCH_SEGMENTS < 2) || (ARC_BATCH_SEGMENTS >= BLOCK_BUFFER_SIZE))
+  #error "ARC_BATCH_SEGMENTS must be between 2 and BLOCK_BUFFER_SIZE-1."
+#endif
+
+#if defined(NATIVE_ARC_BLOCKS) && (defined(ST_PREP_FIXED_POINT) || defined(COREXY))
+  #error "NATIVE_ARC_BLOCKS may not be enabled with ST_PREP_FIXED_POINT or COREXY."
+#endif
+
+#if (SEGMENT_BUFFER_SIZE < 3) || (SEGMENT_BUFFER_SIZE > 65535)
+  #error "SEGMENT_BUFFER_SIZE must be between 3 and 65535."
+#endif
+
+#if defined(PLANNER_RECALCULATE_LIMIT) && ((PLANNER_RECALCULATE_LIMIT < 1) || (PLANNER_RECALCULATE_LIMIT >= BLOCK_BUFFER_SIZE))
+  #error "PLANNER_RECALCULATE_LIMIT must be between 1 and BLOCK_BUFFER_SIZE-1."
+#endif
+
+#if defined(REPORT_RX_CREDIT) && ((RX_CREDIT_REPORT_STEP < 1) || (RX_CREDIT_REPORT_STEP > RX_BUFFER_SIZE))
+  #error "RX_CREDIT_REPORT_STEP must be between 1 and RX_BUFFER_SIZE."
+#endif
+
+#if defined(BINARY_STREAMING) && (BINARY_FRAME_SIZE+1 > RX_BUFFER_SIZE)
+  #error "RX_BUFFER_SIZE must hold at least one binary block frame."
+#endif
+
+#if defined(STREAMING_TOKENIZER) && ((GC_MAX_LINE_WORDS < 1) || (GC_MAX_LINE_WORDS > 255))
+  #error "GC_MAX_LINE_WORDS must be between 1 and 255."
+#endif
+
+#if (N_AXIS < 3) || (N_AXIS > 6)
+  #error "N_AXIS must be between 3 and 6."
+#endif
+#if (N_AXIS > 3) && !(defined(A_STEP_BIT) && defined(A_DIRECTION_BIT))
+  #error "N_AXIS > 3 requires A_STEP_BIT and A_DIRECTION_BIT in cpu_map.h."
+#endif
+#if (N_AXIS > 4) && !(defined(B_STEP_BIT) && defined(B_DIRECTION_BIT))
+  #error "N_AXIS > 4 requires B_STEP_BIT and B_DIRECTION_BIT in cpu_map.h."
+#endif
+#if (N_AXIS > 5) && !(defined(C_STEP_BIT) && defined(C_DIRECTION_BIT))
+  #error "N_AXIS > 5 requires C_STEP_BIT and C_DIRECTION_BIT in cpu_map.h."
+#endif
+
 #if defined(ENABLE_DUAL_AXIS)
   #if !((DUAL_AXIS_SELECT == X_AXIS) || (DUAL_AXIS_SELECT == Y_AXIS))
     #error "Dual axis currently supports X or Y axes only."
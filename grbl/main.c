@@ -27,6 +27,9 @@ volatile uint8_t sys_rt_exec_accessory_override; // 用于主轴/冷却覆盖的
 #ifdef DEBUG
   volatile uint8_t sys_rt_exec_debug;
 #endif
+#ifdef ISR_PROFILE
+  volatile uint8_t sys_rt_exec_isr_profile;
+#endif
 
 
 int main(void)
@@ -81,7 +84,13 @@ int main(void)
     limits_init(); // 初始化限位子系统
     probe_init(); // 初始化对刀子系统
     plan_reset(); // 清空块缓冲区和规划器变量。
+    #ifdef PATH_BLENDING
+      mc_blend_reset(); // 丢弃等待混合的直线。
+    #endif
     st_reset(); // 清空步进子系统变量。
+    #ifdef BINARY_STREAMING
+      binary_reset(); // 二进制帧序号从0开始。
+    #endif
 
     // 同步清空了的G代码和规划器位置到当前系统位置。
     plan_sync_position();
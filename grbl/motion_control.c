@@ -15,22 +15,47 @@
 #include "grbl.h"
 
 
-//在绝对毫米坐标系下执行线性运动。
-//除非反向进给速度为真，否则进给速度以毫米/秒为单位。
-//那么进给率意味着运动应在（1分钟）/进给率时间内完成。
-//注：这是grbl 规划器的主要出口。
-//所有直线运动（包括圆弧线段）在传递给规划器之前必须通过此例程。
-//mc_line和plan_buffer_line的分离主要是为了将非规划器类型的功能从规划器中分离出来，并使齿隙补偿或封闭圆集成简单直接。
-void mc_line(float *target, plan_line_data_t *pl_data)
+//等待规划器缓冲区的空位，然后把直线送进规划器。
+static void mc_buffer_line(float *target, plan_line_data_t *pl_data)
 {
-  //如果启用，请检查是否存在软限位冲突。在这里，所有从Grbl中的任何地方拾取的直线运动都到达这里。
-  if (bit_istrue(settings.flags,BITFLAG_SOFT_LIMIT_ENABLE)) {
-    // 注意: 阻止点动状态。 点动是一种特殊情况，软限位是独立处理的。
-    if (sys.state != STATE_JOG) { limits_soft_check(target); }
-  }
-
-  //如果处于“检查gcode”模式，请阻止规划器运动。软限位仍然有效。
-  if (sys.state == STATE_CHECK_MODE) { return; }
+  #ifdef AMASS_RUNTIME_CUTOFFS
+    //步数超过上限时，AMASS左移后Bresenham计数器会溢出，把直线等分成n段依次加入，各段使用pl_data的副本。
+    //按各轴步数之和加上舍入余量估计，不小于任何电机（包括CoreXY的A、B电机）的步数。圆弧块由mc_arc()保证不超过上限。
+    plan_line_data_t pl_split;
+    #ifdef NATIVE_ARC_BLOCKS
+    if (pl_data->arc == NULL) {
+    #endif
+      float position[N_AXIS], delta[N_AXIS];
+      float step_events = N_AXIS;
+      float millimeters = 0.0;
+      uint8_t idx;
+      plan_get_planner_mpos(position);
+      for (idx=0; idx<N_AXIS; idx++) {
+        delta[idx] = target[idx]-position[idx];
+        step_events += fabs(delta[idx])*settings.steps_per_mm[idx];
+        millimeters += delta[idx]*delta[idx];
+      }
+      if (step_events > AMASS_MAX_STEP_EVENTS) {
+        memcpy(&pl_split, pl_data, sizeof(plan_line_data_t));
+        if (pl_split.condition & PL_COND_FLAG_INVERSE_TIME) {
+          //与mc_arc()相同，先换算为按整条直线的进给速度，各段的时间才正确。
+          pl_split.feed_rate *= sqrt(millimeters);
+          bit_false(pl_split.condition,PL_COND_FLAG_INVERSE_TIME);
+        }
+        float split_target[N_AXIS];
+        uint32_t n = step_events/AMASS_MAX_STEP_EVENTS + 1;
+        uint32_t i;
+        for (i=1; i<n; i++) {
+          for (idx=0; idx<N_AXIS; idx++) { split_target[idx] = position[idx] + delta[idx]*i/n; }
+          mc_buffer_line(split_target, &pl_split);
+          if (sys.abort) { return; }
+        }
+        pl_data = &pl_split; //最后一段到原目标
+      }
+    #ifdef NATIVE_ARC_BLOCKS
+    }
+    #endif
+  #endif
 
   //注意：齿隙补偿可安装在此处。
   //它需要方向信息来跟踪何时在预期直线运动之前插入齿隙直线运动，并需要自己的plan_check_full_buffer()和检查系统中止循环。
@@ -44,7 +69,12 @@ void mc_line(float *target, plan_line_data_t *pl_data)
   do {
     protocol_execute_realtime(); //检查是否有任何运行时命令
     if (sys.abort) { return; } //退出，如果系统中止。
-    if ( plan_check_full_buffer() ) { protocol_auto_cycle_start(); } //缓冲区满时自动循环开始。
+    if ( plan_check_full_buffer() ) {
+      protocol_auto_cycle_start(); //缓冲区满时自动循环开始。
+      #ifdef PLANNER_DEFERRED_RECALCULATE
+        plan_recalculate_deferred(); //等待空位时完成被截断的重新规划。
+      #endif
+    }
     else { break; }
   } while (1);
 
@@ -60,6 +90,144 @@ void mc_line(float *target, plan_line_data_t *pl_data)
 }
 
 
+#ifdef PATH_BLENDING
+  //留在运动控制中等待与下一条直线混合的直线。起点不用记：已经送出的部分与它在同一直线上。
+  static struct {
+    uint8_t active;
+    float target[N_AXIS];   //直线终点，即拐点
+    float unit_vec[N_AXIS]; //直线方向
+    float millimeters;      //直线的全长，每端最多让出一半给拐角曲线
+    plan_line_data_t pl_data;
+  } mc_blend;
+
+
+  //送出留下的直线。
+  void mc_blend_flush()
+  {
+    if (mc_blend.active) {
+      mc_blend.active = false;
+      mc_buffer_line(mc_blend.target, &mc_blend.pl_data);
+    }
+  }
+
+
+  //复位时丢弃留下的直线。
+  void mc_blend_reset()
+  {
+    mc_blend.active = false;
+  }
+
+
+  //留下新直线，并与上一条直线在拐点V处混合：上一条直线送到S=V-d*u1，然后以V为控制点的二次贝塞尔曲线到E=V+d*u2。
+  //曲线中点离V最远，距离为d*|u2-u1|/4=d*sin(φ/2)/2，φ为转角，所以d=2P/sin(φ/2)时不超过公差P。
+  //曲线的二阶导数为2d(u2-u1)，分成n段弦时弦高不超过d*|u2-u1|/(4n^2)，按$12圆弧公差取n。
+  //节点偏差允许的拐角速度已经达到进给速度时不混合，免得平缓的拐角也占用更多规划器块。
+  static void mc_blend_line(float *target, plan_line_data_t *pl_data)
+  {
+    float unit_vec[N_AXIS];
+    float millimeters = 0.0;
+    uint8_t idx;
+    if (mc_blend.active) { memcpy(unit_vec, mc_blend.target, sizeof(unit_vec)); }
+    else { plan_get_planner_mpos(unit_vec); }
+    for (idx=0; idx<N_AXIS; idx++) {
+      unit_vec[idx] = target[idx]-unit_vec[idx];
+      millimeters += unit_vec[idx]*unit_vec[idx];
+    }
+    millimeters = sqrt(millimeters);
+    if (millimeters == 0.0) {
+      //长度为零的直线（激光模式下可能用来同步主轴）照常送进规划器。
+      mc_blend_flush();
+      if (sys.abort) { return; }
+      mc_buffer_line(target, pl_data);
+      return;
+    }
+    float cos_angle = 0.0;
+    for (idx=0; idx<N_AXIS; idx++) {
+      unit_vec[idx] /= millimeters;
+      if (mc_blend.active) { cos_angle += unit_vec[idx]*mc_blend.unit_vec[idx]; }
+    }
+
+    if (mc_blend.active) {
+      mc_blend.active = false;
+      float sin_half = 0.5*(1.0-cos_angle); // sin(φ/2)^2
+      uint8_t blend = ((sin_half > 0.0) && (mc_blend.pl_data.condition == pl_data->condition));
+      if (blend) {
+        //与plan_buffer_line()中的节点速度相同，其中的半角正弦即cos(φ/2)。
+        float junction_unit_vec[N_AXIS];
+        for (idx=0; idx<N_AXIS; idx++) { junction_unit_vec[idx] = unit_vec[idx]-mc_blend.unit_vec[idx]; }
+        convert_delta_vector_to_unit_vector(junction_unit_vec);
+        float junction_acceleration = limit_value_by_axis_maximum(settings.acceleration, junction_unit_vec);
+        float cos_half = sqrt(1.0-sin_half);
+        float feed_rate = min(pl_data->feed_rate, limit_value_by_axis_maximum(settings.max_rate, unit_vec));
+        blend = (junction_acceleration*settings.junction_deviation*cos_half < feed_rate*feed_rate*(1.0-cos_half));
+      }
+      if (blend) {
+        sin_half = sqrt(sin_half);
+        float distance = 2.0*pl_data->blend_tolerance/sin_half;
+        distance = min(distance, 0.5*min(millimeters, mc_blend.millimeters));
+        float start[N_AXIS], end[N_AXIS], point[N_AXIS];
+        for (idx=0; idx<N_AXIS; idx++) {
+          start[idx] = mc_blend.target[idx]-distance*mc_blend.unit_vec[idx];
+          end[idx] = mc_blend.target[idx]+distance*unit_vec[idx];
+        }
+        mc_buffer_line(start, &mc_blend.pl_data);
+        uint16_t segments = ceil(sqrt(0.5*distance*sin_half/settings.arc_tolerance));
+        uint16_t i;
+        for (i=1; i<segments; i++) {
+          if (sys.abort) { return; }
+          float t = (float)i/segments;
+          for (idx=0; idx<N_AXIS; idx++) {
+            point[idx] = (1.0-t)*(1.0-t)*start[idx] + 2.0*t*(1.0-t)*mc_blend.target[idx] + t*t*end[idx];
+          }
+          mc_buffer_line(point, pl_data);
+        }
+        if (sys.abort) { return; }
+        mc_buffer_line(end, pl_data);
+      } else {
+        mc_buffer_line(mc_blend.target, &mc_blend.pl_data); // 直线继续或条件不同，不混合。
+      }
+      if (sys.abort) { return; }
+    }
+
+    mc_blend.active = true;
+    memcpy(mc_blend.target, target, sizeof(mc_blend.target));
+    memcpy(mc_blend.unit_vec, unit_vec, sizeof(unit_vec));
+    mc_blend.millimeters = millimeters;
+    memcpy(&mc_blend.pl_data, pl_data, sizeof(plan_line_data_t));
+  }
+#endif
+
+
+//在绝对毫米坐标系下执行线性运动。
+//除非反向进给速度为真，否则进给速度以毫米/秒为单位。
+//那么进给率意味着运动应在（1分钟）/进给率时间内完成。
+//注：这是grbl 规划器的主要出口。
+//所有直线运动（包括圆弧线段）在传递给规划器之前必须通过此例程。
+//mc_line和plan_buffer_line的分离主要是为了将非规划器类型的功能从规划器中分离出来，并使齿隙补偿或封闭圆集成简单直接。
+void mc_line(float *target, plan_line_data_t *pl_data)
+{
+  //如果启用，请检查是否存在软限位冲突。在这里，所有从Grbl中的任何地方拾取的直线运动都到达这里。
+  if (bit_istrue(settings.flags,BITFLAG_SOFT_LIMIT_ENABLE)) {
+    // 注意: 阻止点动状态。 点动是一种特殊情况，软限位是独立处理的。
+    if (sys.state != STATE_JOG) { limits_soft_check(target); }
+  }
+
+  //如果处于“检查gcode”模式，请阻止规划器运动。软限位仍然有效。
+  if (sys.state == STATE_CHECK_MODE) { return; }
+
+  #ifdef PATH_BLENDING
+    if (pl_data->blend_tolerance > 0.0) {
+      mc_blend_line(target, pl_data);
+      return;
+    }
+    mc_blend_flush(); // 精确路径的运动之前送出留下的直线。
+    if (sys.abort) { return; }
+  #endif
+
+  mc_buffer_line(target, pl_data);
+}
+
+
 //以偏移模式格式执行圆弧。
 //位置==当前xyz，目标==目标xyz，偏移==与当前xyz的偏移，轴X定义刀具空间中的圆平面，轴线性是螺旋移动的方向，半径==圆半径，是顺时针布尔值。
 //用于矢量变换方向。
@@ -83,6 +251,33 @@ void mc_arc(float *target, plan_line_data_t *pl_data, float *position, float *of
     if (angular_travel <= ARC_ANGULAR_TRAVEL_EPSILON) { angular_travel += 2*M_PI; }
   }
 
+  #ifdef NATIVE_ARC_BLOCKS
+    //整个圆弧作为一个规划器块，由段准备沿圆弧插补。软限位需要检查每个弦段的终点，启用时仍然分段。
+    uint8_t native_arc = bit_isfalse(settings.flags,BITFLAG_SOFT_LIMIT_ENABLE);
+    #ifdef AMASS_RUNTIME_CUTOFFS
+      //圆弧块不能拆分，虚拟步数超过块的步数上限时也分段。与plan_compute_arc_block()一样按最大的每毫米步数计算。
+      float arc_mm = fabs(angular_travel)*radius;
+      float linear_mm = target[axis_linear] - position[axis_linear];
+      float step_per_mm = max(settings.steps_per_mm[axis_0], settings.steps_per_mm[axis_1]);
+      step_per_mm = max(step_per_mm, settings.steps_per_mm[axis_linear]);
+      if (sqrt(arc_mm*arc_mm + linear_mm*linear_mm)*step_per_mm > AMASS_MAX_STEP_EVENTS) { native_arc = false; }
+    #endif
+    if (native_arc) {
+      plan_arc_t arc;
+      arc.r_axis0 = r_axis0;
+      arc.r_axis1 = r_axis1;
+      arc.angular_travel = angular_travel;
+      arc.linear_travel = target[axis_linear] - position[axis_linear];
+      arc.axis_0 = axis_0;
+      arc.axis_1 = axis_1;
+      arc.axis_linear = axis_linear;
+      pl_data->arc = &arc;
+      mc_line(target, pl_data);
+      pl_data->arc = NULL;
+      return;
+    }
+  #endif
+
   //注：段端点位于弧上，这可能导致弧直径小于（2x）设置。弧长公差。
 //对于99%的用户来说，这很好。
 //如果需要不同的圆弧段拟合，即最小二乘法，圆弧中点，只需更改mm_per_arc_segment计算。
@@ -126,30 +321,61 @@ void mc_arc(float *target, plan_line_data_t *pl_data, float *position, float *of
     float sin_T = theta_per_segment*0.16666667*(cos_T + 4.0);
     cos_T *= 0.5;
 
-    float sin_Ti;
-    float cos_Ti;
     float r_axisi;
     uint16_t i;
     uint8_t count = 0;
+    #ifdef ARC_BATCH_SEGMENTS
+      float half_inv_radius_sqr = 0.5/(r_axis0*r_axis0 + r_axis1*r_axis1); //校正的目标是初始半径向量的长度
+      uint8_t batch_count = 0;
+    #else
+      float sin_Ti;
+      float cos_Ti;
+    #endif
 
     for (i = 1; i<segments; i++) { //增量（段-1）。
 
-      if (count < N_ARC_CORRECTION) {
-        //应用向量旋转矩阵约~40 微秒
+      #ifdef ARC_BATCH_SEGMENTS
+        if (batch_count == 0) {
+          //等到规划器有整批的空位，然后连续加入整批弦段。中间不会等待，推迟的计划只存在很短的时间。
+          uint8_t batch_blocks = ARC_BATCH_SEGMENTS;
+          if (segments-i < ARC_BATCH_SEGMENTS) { batch_blocks = segments-i; }
+          while (plan_get_block_buffer_available() < batch_blocks) {
+            protocol_execute_realtime();
+            if (sys.abort) { return; }
+            protocol_auto_cycle_start(); //缓冲区满时自动循环开始。
+          }
+          plan_defer_recalculate(true);
+        }
+
+        //应用向量旋转矩阵
         r_axisi = r_axis0*sin_T + r_axis1*cos_T;
         r_axis0 = r_axis0*cos_T - r_axis1*sin_T;
         r_axis1 = r_axisi;
-        count++;
-      } else {
-        //对半径向量进行圆弧校正。仅每N_ARC_CORRECTION增量计算一次。
-        
-        //约~375 微秒，通过应用初始半径向量（=-offset）的变换矩阵来计算精确位置。
-        cos_Ti = cos(i*theta_per_segment);
-        sin_Ti = sin(i*theta_per_segment);
-        r_axis0 = -offset[axis_0]*cos_Ti + offset[axis_1]*sin_Ti;
-        r_axis1 = -offset[axis_0]*sin_Ti - offset[axis_1]*cos_Ti;
-        count = 0;
-      }
+        if (++count == N_ARC_CORRECTION) {
+          //半径长度校正：1/sqrt()的一步牛顿迭代，s = 1.5 - 0.5*|r|^2/R^2，误差很小时收敛到|r| = R。
+          float scale = 1.5 - (r_axis0*r_axis0 + r_axis1*r_axis1)*half_inv_radius_sqr;
+          r_axis0 *= scale;
+          r_axis1 *= scale;
+          count = 0;
+        }
+      #else
+        if (count < N_ARC_CORRECTION) {
+          //应用向量旋转矩阵约~40 微秒
+          r_axisi = r_axis0*sin_T + r_axis1*cos_T;
+          r_axis0 = r_axis0*cos_T - r_axis1*sin_T;
+          r_axis1 = r_axisi;
+          count++;
+        } else {
+          //对半径向量进行圆弧校正。仅每N_ARC_CORRECTION增量计算一次。
+          
+          //约~375 微秒，通过应用初始半径向量（=-offset）的变换矩阵来计算精确位置。
+          cos_Ti = cos(i*theta_per_segment);
+          sin_Ti = sin(i*theta_per_segment);
+          r_axis0 = -offset[axis_0]*cos_Ti + offset[axis_1]*sin_Ti;
+          r_axis1 = -offset[axis_0]*sin_Ti - offset[axis_1]*cos_Ti;
+          count = 0;
+        }
+      #endif
 
       //更新arc_target位置
       position[axis_0] = center_axis0 + r_axis0;
@@ -158,9 +384,20 @@ void mc_arc(float *target, plan_line_data_t *pl_data, float *position, float *of
 
       mc_line(position, pl_data);
 
-      //在系统中止时，保持中间循环。运行时命令检查已由mc_line执行。
+      //在系统中止时，保持中间循环。运行时命令检查已由mc_line执行。复位时规划器会清除推迟状态。
       if (sys.abort) { return; }
+
+      #ifdef ARC_BATCH_SEGMENTS
+        //整批加入后一起重新规划。
+        if (++batch_count == ARC_BATCH_SEGMENTS) {
+          plan_defer_recalculate(false);
+          batch_count = 0;
+        }
+      #endif
     }
+    #ifdef ARC_BATCH_SEGMENTS
+      plan_defer_recalculate(false);
+    #endif
   }
   //确保最后一段到达目标位置。
   mc_line(target, pl_data);
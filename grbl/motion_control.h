@@ -37,6 +37,14 @@ void mc_line(float *target, plan_line_data_t *pl_data);
 void mc_arc(float *target, plan_line_data_t *pl_data, float *position, float *offset, float radius,
   uint8_t axis_0, uint8_t axis_1, uint8_t axis_linear, uint8_t is_clockwise_arc);
 
+#ifdef PATH_BLENDING
+  //把等待与下一条直线混合的直线送进规划器。缓冲区同步、'$'命令和规划器将要排空时调用。
+  void mc_blend_flush();
+
+  //复位时丢弃等待混合的直线。
+  void mc_blend_reset();
+#endif
+
 //停留特定的秒数
 void mc_dwell(float seconds);
 
@@ -15,9 +15,6 @@
 #include "grbl.h"
 
 
-#define MAX_INT_DIGITS 8 //int32（和浮点）中的最大位数
-
-
 //从字符串中提取浮点值。下面的代码松散地基于Michael Stumpf和Dmitry Xmelkov的avr libc strod（）函数以及许多免费提供的转换方法示例，但已经针对Grbl进行了高度优化。众所周知
 //在CNC应用中，典型的十进制值预计在E0到E-4之间。
 //g代码不支持科学符号，在某些CNC系统上，“E”字符可能是g代码。因此，“E”符号不会被识别。
@@ -65,35 +62,37 @@ uint8_t read_float(char *line, uint8_t *char_counter, float *float_ptr)
   //如果未读取任何数字，则返回。
   if (!ndigit) { return(false); };
 
-  //将整数转换为浮点。
+  *float_ptr = read_float_convert(intval, exp, isnegative);
+  *char_counter = ptr - line - 1; //将char_counter设置为下一个语句
+
+  return(true);
+}
+
+
+//10的幂。直到10^10都能用float精确表示。
+static const float read_float_pow10[] PROGMEM = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10 };
+
+float read_float_convert(uint32_t intval, int8_t exp, bool isnegative)
+{
+  //将整数转换为浮点。不超过2^24（7位数字）时是精确的。
   float fval;
   fval = (float)intval;
 
-  //应用十进制。对于预期的E0到E-4范围，应执行不超过两次浮点乘法。
-  if (fval != 0) {
-    while (exp <= -2) {
-      fval *= 0.01;
-      exp += 2;
-    }
-    if (exp < 0) {
-      fval *= 0.1;
-    } else if (exp > 0) {
-      do {
-        fval *= 10.0;
-      } while (--exp > 0);
+  //应用十进制。整数值不缩放，带小数时只用一次除以精确的10的幂，不超过7位有效数字时结果是正确舍入的，与strtod()相同。
+  //原来按0.01和0.1连乘，每次乘法都有舍入，而且0.01和0.1本身不能精确表示。小数位数不超过MAX_INT_DIGITS，查表即可。
+  if (exp < 0) {
+    fval /= pgm_read_float(&read_float_pow10[-exp]);
+  } else if (exp > 0) {
+    while (exp > 10) {
+      fval *= 1e10;
+      exp -= 10;
     }
+    fval *= pgm_read_float(&read_float_pow10[exp]);
   }
 
   //用正确的符号指定浮点值。
-  if (isnegative) {
-    *float_ptr = -fval;
-  } else {
-    *float_ptr = fval;
-  }
-
-  *char_counter = ptr - line - 1; //将char_counter设置为下一个语句
-
-  return(true);
+  if (isnegative) { return(-fval); }
+  return(fval);
 }
 
 
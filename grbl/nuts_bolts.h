@@ -19,13 +19,22 @@
 #define true 1
 
 #define SOME_LARGE_VALUE 1.0E+38
+#define MAX_INT_DIGITS 8 //int32（和浮点）中的最大位数
 
 //轴数组索引值。必须以0开头并连续。
 #define N_AXIS 3//轴数
 #define X_AXIS 0//轴索引值。
 #define Y_AXIS 1
 #define Z_AXIS 2
-// #define A_AXIS 3
+#if N_AXIS > 3
+  #define A_AXIS 3 //旋转轴等附加轴。cpu_map.h需要定义对应的引脚。
+#endif
+#if N_AXIS > 4
+  #define B_AXIS 4
+#endif
+#if N_AXIS > 5
+  #define C_AXIS 5
+#endif
 
 //CoreXY电机赋值。不要改变。
 //注意：如果A和B电机轴绑定发生更改，则会影响Corerxy方程。
@@ -60,6 +69,9 @@
 //从字符串中读取浮点值。行指向输入缓冲区，char_counter是指向行的当前字符的索引器，而float_ptr是指向结果变量的指针。成功时返回true
 uint8_t read_float(char *line, uint8_t *char_counter, float *float_ptr);
 
+//把read_float()累积的整数部分和十进制指数转换为浮点数。逐字符解析数值时使用，以得到与read_float()完全相同的结果。
+float read_float_convert(uint32_t intval, int8_t exp, bool isnegative);
+
 //非阻塞延迟功能用于一般操作和暂停功能。
 void delay_sec(float seconds, uint8_t mode);
 
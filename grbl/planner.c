@@ -20,6 +20,12 @@ static uint8_t block_buffer_tail;     //要立即处理的块的索引
 static uint8_t block_buffer_head;     //要推送的下一个块的索引
 static uint8_t next_buffer_head;      //下一个缓冲头的索引
 static uint8_t block_buffer_planned;  //优化后的规划块的索引
+#ifdef PLANNER_DEFERRED_RECALCULATE
+  static uint8_t recalculate_pending;  //上次重新规划被截断或推迟，还需要一次完整的重新规划
+#endif
+#ifdef ARC_BATCH_SEGMENTS
+  static uint8_t recalculate_deferred; //批量加入块，plan_buffer_line()不重新规划
+#endif
 
 //定义规划器变量
 typedef struct {
@@ -92,15 +98,41 @@ static uint8_t plan_prev_block_index(uint8_t block_index)
   (3) 最大化规划器缓冲区大小。 这也将增加规划器计算的总距离。
   它还增加了计划者计算最优计划所需的计算次数，因此请仔细选择。
   Arduino 328p内存已经达到最大值，但未来的ARM版本应该有足够的内存和速度，以支持多达100个或更多的前瞻块。
+
+  启用PLANNER_RECALCULATE_LIMIT时，limit不为零表示最多重新计算缓冲区末尾的limit个块。反向传递在截断点停止，
+  截断点之前的块保持原来的进入速度。原来的计划假设在旧的最后一个块结束时停止，新的块只会让它们可以更快，
+  所以原来的速度仍然可行，只是不再最优。向前传递从截断点开始，保证截断点前后的加速度连续。
+  截断时不移动计划指针，之后由plan_recalculate_deferred()做一次完整的重新规划。
 */
-static void planner_recalculate()
+static void planner_recalculate(uint8_t limit)
 {
+  #ifdef PLANNER_DEFERRED_RECALCULATE
+    recalculate_pending = false; //这次重新规划包括之前推迟的部分
+  #endif
+
   //将块索引初始化为规划器缓冲区中的最后一个块。
   uint8_t block_index = plan_prev_block_index(block_buffer_head);
 
   // 退出。 只有一个可规划的块，无法执行任何操作。
   if (block_index == block_buffer_planned) { return; }
 
+  //反向传递停止的块。不截断时就是计划指针。
+  uint8_t block_stop = block_buffer_planned;
+  uint8_t planned_update = true; //截断时前面的块还不是最优的，不能移动计划指针。
+  #ifdef PLANNER_RECALCULATE_LIMIT
+    if (limit) {
+      uint8_t block_count = block_index - block_buffer_planned; //计划指针之后需要重新计算的块数
+      if (block_index < block_buffer_planned) { block_count += BLOCK_BUFFER_SIZE; }
+      if (block_count > limit) {
+        block_stop = (block_index >= limit) ? (block_index - limit) : (block_index + BLOCK_BUFFER_SIZE - limit);
+        planned_update = false;
+        recalculate_pending = true;
+      }
+    }
+  #else
+    (void)limit; //未启用截断时不使用
+  #endif
+
   //反向通过：粗略地最大化所有可能的减速曲线，从缓冲区中的最后一个块开始反向规划。
   //当达到最后一个最优计划或尾部指针时停止计划。
   // 注：向前传递将在稍后完善和纠正反向传递，以创建最佳计划。
@@ -112,11 +144,11 @@ static void planner_recalculate()
   current->entry_speed_sqr = min( current->max_entry_speed_sqr, 2*current->acceleration*current->millimeters);
 
   block_index = plan_prev_block_index(block_index);
-  if (block_index == block_buffer_planned) { //缓冲区中只有两个可规划块。反向传递完成。
+  if (block_index == block_stop) { //缓冲区中只有两个可规划块。反向传递完成。
 //检查第一块是否为尾部。如果是，通知步进器更新其当前参数。
     if (block_index == block_buffer_tail) { st_update_plan_block_parameters(); }
   } else { //三个或三个以上可规划区块
-    while (block_index != block_buffer_planned) {
+    while (block_index != block_stop) {
       next = current;
       current = &block_buffer[block_index];
       block_index = plan_prev_block_index(block_index);
@@ -138,8 +170,8 @@ static void planner_recalculate()
 
   //向前传递：向前规划从计划指针开始的加速曲线。
 //还扫描最佳计划断点，并适当更新计划指针。
-  next = &block_buffer[block_buffer_planned]; //从缓冲区计划指针开始
-  block_index = plan_next_block_index(block_buffer_planned);
+  next = &block_buffer[block_stop]; //从缓冲区计划指针开始
+  block_index = plan_next_block_index(block_stop);
   while (block_index != block_buffer_head) {
     current = next;
     next = &block_buffer[block_index];
@@ -151,13 +183,13 @@ static void planner_recalculate()
       // 如果为true，则当前块为完全加速，我们可以向前移动计划指针。
       if (entry_speed_sqr < next->entry_speed_sqr) {
         next->entry_speed_sqr = entry_speed_sqr; // 总是 <= max_entry_speed_sqr. 向后传递设置此选项。
-        block_buffer_planned = block_index; //设置最佳计划指针。
+        if (planned_update) { block_buffer_planned = block_index; } //设置最佳计划指针。
       }
     }
 
     //以最大进入速度设置的任何块也会在缓冲区中创建一个最佳计划。
 //当计划被缓冲区的开始和一个最大进入速度或两个最大进入速度包围时，在逻辑上不能进一步改进中间的每个块。因此，我们不再需要重新计算它们。
-    if (next->entry_speed_sqr == next->max_entry_speed_sqr) { block_buffer_planned = block_index; }
+    if (planned_update && (next->entry_speed_sqr == next->max_entry_speed_sqr)) { block_buffer_planned = block_index; }
     block_index = plan_next_block_index( block_index );
   }
 }
@@ -176,6 +208,12 @@ void plan_reset_buffer()
   block_buffer_head = 0; // Empty = tail
   next_buffer_head = 1; // plan_next_block_index(block_buffer_head)
   block_buffer_planned = 0; // = block_buffer_tail;
+  #ifdef PLANNER_DEFERRED_RECALCULATE
+    recalculate_pending = false;
+  #endif
+  #ifdef ARC_BATCH_SEGMENTS
+    recalculate_deferred = false;
+  #endif
 }
 
 
@@ -264,6 +302,151 @@ void plan_update_velocity_profile_parameters()
 }
 
 
+#ifdef NATIVE_ARC_BLOCKS
+  //计算圆弧块的距离、虚拟步数和速度限制。unit_vec和exit_unit_vec返回起点和终点的切线方向，用于计算前后两个结点。
+  //平面两轴的速度都可能达到整个圆弧的速度，所以按两轴中较小的加速度和最大速率限制。另外，向心加速度v^2/R不能超过加速度。
+  static uint8_t plan_compute_arc_block(plan_block_t *block, plan_arc_t *arc, float *unit_vec, float *exit_unit_vec)
+  {
+    float radius = sqrt(arc->r_axis0*arc->r_axis0 + arc->r_axis1*arc->r_axis1);
+    float arc_mm = fabs(arc->angular_travel)*radius;
+    block->millimeters = sqrt(arc_mm*arc_mm + arc->linear_travel*arc->linear_travel);
+    float step_per_mm = max(settings.steps_per_mm[arc->axis_0], settings.steps_per_mm[arc->axis_1]);
+    step_per_mm = max(step_per_mm, settings.steps_per_mm[arc->axis_linear]);
+    block->step_event_count = ceil(block->millimeters*step_per_mm);
+    if (block->step_event_count == 0) { return(PLAN_EMPTY_BLOCK); }
+    block->arc = *arc;
+
+    float inv_mm = 1.0/block->millimeters;
+    float limit_vec[N_AXIS];
+    memset(limit_vec, 0, sizeof(limit_vec));
+    limit_vec[arc->axis_0] = arc_mm*inv_mm;
+    limit_vec[arc->axis_1] = limit_vec[arc->axis_0];
+    limit_vec[arc->axis_linear] = arc->linear_travel*inv_mm;
+    block->acceleration = limit_value_by_axis_maximum(settings.acceleration, limit_vec);
+    block->rapid_rate = limit_value_by_axis_maximum(settings.max_rate, limit_vec);
+    float centripetal_rate = sqrt(block->acceleration*radius);
+    if (block->rapid_rate > centripetal_rate) { block->rapid_rate = centripetal_rate; }
+
+    //切线方向：半径向量逆时针转90度，乘以角度的符号。
+    float scale = arc->angular_travel*inv_mm;
+    float cos_T = cos(arc->angular_travel);
+    float sin_T = sin(arc->angular_travel);
+    memset(unit_vec, 0, N_AXIS*sizeof(float));
+    unit_vec[arc->axis_0] = -arc->r_axis1*scale;
+    unit_vec[arc->axis_1] = arc->r_axis0*scale;
+    unit_vec[arc->axis_linear] = arc->linear_travel*inv_mm;
+    memcpy(exit_unit_vec, unit_vec, N_AXIS*sizeof(float));
+    exit_unit_vec[arc->axis_0] = -(arc->r_axis0*sin_T + arc->r_axis1*cos_T)*scale;
+    exit_unit_vec[arc->axis_1] = (arc->r_axis0*cos_T - arc->r_axis1*sin_T)*scale;
+    return(PLAN_OK);
+  }
+#endif
+
+
+#ifdef PLANNER_MERGE_COLLINEAR
+  //尝试把准备好的新块合并到缓冲区的最后一个块中。成功时更新最后一个块和规划器状态，返回true，新块不加入缓冲区。
+  //段准备只取出尾部的块，所以最后一个块不是尾部时可以安全地修改。
+  //注：块的最大节点速度仍按第一条线段的方向计算，两者的夹角受公差限制，差别可以忽略。
+  static uint8_t plan_merge_collinear(plan_block_t *block, float *unit_vec)
+  {
+    if (block->condition & (PL_COND_FLAG_SYSTEM_MOTION|PL_COND_FLAG_INVERSE_TIME)) { return(false); }
+    if (block_buffer_head == block_buffer_tail) { return(false); }
+    uint8_t block_index = plan_prev_block_index(block_buffer_head);
+    if (block_index == block_buffer_tail) { return(false); } //可能已被段准备取出
+    plan_block_t *prev = &block_buffer[block_index];
+    if (prev->condition != block->condition) { return(false); }
+    if (prev->programmed_rate != block->programmed_rate) {
+      if (!(block->condition & PL_COND_FLAG_RAPID_MOTION)) { return(false); } //快速运动的速率与方向有关，下面比较标称速度
+    }
+    #ifdef VARIABLE_SPINDLE
+      if (prev->spindle_speed != block->spindle_speed) { return(false); }
+    #endif
+    #ifdef USE_LINE_NUMBERS
+      if (prev->line_number != block->line_number) { return(false); }
+    #endif
+    #ifdef NATIVE_ARC_BLOCKS
+      if ((prev->arc.angular_travel != 0.0) || (block->arc.angular_travel != 0.0)) { return(false); }
+    #endif
+
+    //合并后的位移（步）和直线
+    int32_t delta_steps[N_AXIS];
+    float delta_mm[N_AXIS];
+    uint32_t step_event_count = 0;
+    float theta_sqr = 0.0;
+    uint8_t idx;
+    for (idx=0; idx<N_AXIS; idx++) {
+      uint8_t direction_mask = get_direction_pin_mask(idx);
+      delta_steps[idx] = (prev->direction_bits & direction_mask) ? -(int32_t)prev->steps[idx] : prev->steps[idx];
+      if (block->direction_bits & direction_mask) { delta_steps[idx] -= block->steps[idx]; }
+      else { delta_steps[idx] += block->steps[idx]; }
+      delta_mm[idx] = delta_steps[idx]/settings.steps_per_mm[idx];
+      step_event_count = max(step_event_count, (uint32_t)labs(delta_steps[idx]));
+      float delta_unit = pl.previous_unit_vec[idx]-unit_vec[idx];
+      theta_sqr += delta_unit*delta_unit;
+    }
+    #ifdef ST_PREP_FIXED_POINT
+      if (step_event_count > (1UL<<24)) { return(false); }
+    #endif
+    float millimeters = convert_delta_vector_to_unit_vector(delta_mm);
+
+    //上一块的终点到合并后直线的距离为|a||b|sin(θ)/|a+b|，sin(θ)用两个单位向量之差的长度代替，小角度时没有相消误差且总是偏大。
+    //上一块中原来各端点的距离最多再增加这么多，累计值作为上界。反向的线段使分母趋于零，这里的比较也排除NaN。
+    float deviation = prev->merge_deviation + prev->millimeters*block->millimeters*sqrt(theta_sqr)/millimeters;
+    if (!(deviation <= PLANNER_MERGE_COLLINEAR)) { return(false); }
+
+    //合并后的块仍是最后一个块，以零速度结束。原来计划的进入速度必须仍能减速到零，并且不超过新的标称速度，
+    //这样计划中的速度都不用降低，计划指针之前的最优计划不受影响。
+    float acceleration = limit_value_by_axis_maximum(settings.acceleration, delta_mm);
+    #ifdef S_CURVE_PROFILE
+      acceleration *= (2.0/3.0);
+    #endif
+    if (prev->entry_speed_sqr > 2*acceleration*millimeters) { return(false); }
+    float rapid_rate = prev->rapid_rate;
+    float programmed_rate = prev->programmed_rate;
+    prev->rapid_rate = limit_value_by_axis_maximum(settings.max_rate, delta_mm);
+    if (block->condition & PL_COND_FLAG_RAPID_MOTION) { prev->programmed_rate = prev->rapid_rate; }
+    float nominal_speed = plan_compute_profile_nominal_speed(prev);
+    if (prev->entry_speed_sqr > nominal_speed*nominal_speed) {
+      prev->rapid_rate = rapid_rate;
+      prev->programmed_rate = programmed_rate;
+      return(false);
+    }
+
+    //延长最后一个块。进入速度不变，由重新规划提高。
+    prev->step_event_count = step_event_count;
+    prev->direction_bits = 0;
+    for (idx=0; idx<N_AXIS; idx++) {
+      prev->steps[idx] = labs(delta_steps[idx]);
+      if (delta_steps[idx] < 0) { prev->direction_bits |= get_direction_pin_mask(idx); }
+    }
+    prev->millimeters = millimeters;
+    prev->acceleration = acceleration;
+    prev->merge_deviation = deviation;
+    if (prev->max_entry_speed_sqr > nominal_speed*nominal_speed) { prev->max_entry_speed_sqr = nominal_speed*nominal_speed; }
+    pl.previous_nominal_speed = nominal_speed;
+    memcpy(pl.previous_unit_vec, delta_mm, sizeof(delta_mm)); //下一个结点使用合并后直线的方向
+    return(true);
+  }
+#endif
+
+
+//加入或延长块之后重新规划。
+static void planner_recalculate_added()
+{
+  #ifdef ARC_BATCH_SEGMENTS
+    if (recalculate_deferred) { //批量加入时推迟到整批加入之后。新块的进入速度为零。
+      recalculate_pending = true;
+      return;
+    }
+  #endif
+  #ifdef PLANNER_RECALCULATE_LIMIT
+    planner_recalculate(PLANNER_RECALCULATE_LIMIT);
+  #else
+    planner_recalculate(0);
+  #endif
+}
+
+
 /* 向缓冲区添加新的线性移动。
   target[N_AXIS]是有符号的绝对目标位置，单位为毫米。
    进给速率指定运动的速度。
@@ -341,6 +524,19 @@ uint8_t plan_buffer_line(float *target, plan_line_data_t *pl_data)
     if (delta_mm < 0.0 ) { block->direction_bits |= get_direction_pin_mask(idx); }
   }
 
+  #ifdef AMASS_RUNTIME_CUTOFFS
+    //步数超过上限时，AMASS左移后Bresenham计数器会溢出。直线和圆弧由mc_buffer_line()和mc_arc()事先拆分，
+    //这里只拒绝不经过它们的归位和停车运动。
+    if (block->step_event_count > AMASS_MAX_STEP_EVENTS) { return(PLAN_EMPTY_BLOCK); }
+  #endif
+
+  #ifdef NATIVE_ARC_BLOCKS
+    float exit_unit_vec[N_AXIS];
+    if (pl_data->arc != NULL) {
+      if (plan_compute_arc_block(block, pl_data->arc, unit_vec, exit_unit_vec) == PLAN_EMPTY_BLOCK) { return(PLAN_EMPTY_BLOCK); }
+    } else {
+  #endif
+
   //如果这是一个长度为零的区块，则退出。极不可能发生。
   if (block->step_event_count == 0) { return(PLAN_EMPTY_BLOCK); }
 
@@ -350,6 +546,14 @@ uint8_t plan_buffer_line(float *target, plan_line_data_t *pl_data)
   block->acceleration = limit_value_by_axis_maximum(settings.acceleration, unit_vec);
   block->rapid_rate = limit_value_by_axis_maximum(settings.max_rate, unit_vec);
 
+  #ifdef NATIVE_ARC_BLOCKS
+      memcpy(exit_unit_vec, unit_vec, sizeof(unit_vec));
+    }
+  #endif
+  #ifdef S_CURVE_PROFILE
+    block->acceleration *= (2.0/3.0); // S形斜坡的峰值加速度是平均值的1.5倍，设置值作为峰值。
+  #endif
+
   //存储编程速率。
   if (block->condition & PL_COND_FLAG_RAPID_MOTION) { block->programmed_rate = block->rapid_rate; }
   else { 
@@ -357,6 +561,14 @@ uint8_t plan_buffer_line(float *target, plan_line_data_t *pl_data)
     if (block->condition & PL_COND_FLAG_INVERSE_TIME) { block->programmed_rate *= block->millimeters; }
   }
 
+  #ifdef PLANNER_MERGE_COLLINEAR
+    if (plan_merge_collinear(block, unit_vec)) {
+      memcpy(pl.position, target_steps, sizeof(target_steps));
+      planner_recalculate_added();
+      return(PLAN_OK);
+    }
+  #endif
+
   //TODO：从静止开始时，需要检查此处理零结速度的方法。
   if ((block_buffer_head == block_buffer_tail) || (block->condition & PL_COND_FLAG_SYSTEM_MOTION)) {
 
@@ -414,7 +626,11 @@ uint8_t plan_buffer_line(float *target, plan_line_data_t *pl_data)
     pl.previous_nominal_speed = nominal_speed;
     
     //更新以前的路径单位向量和规划器位置。
-    memcpy(pl.previous_unit_vec, unit_vec, sizeof(unit_vec)); // pl.previous_unit_vec[] = unit_vec[]
+    #ifdef NATIVE_ARC_BLOCKS
+      memcpy(pl.previous_unit_vec, exit_unit_vec, sizeof(exit_unit_vec)); //圆弧的下一个结点使用终点的切线。
+    #else
+      memcpy(pl.previous_unit_vec, unit_vec, sizeof(unit_vec)); // pl.previous_unit_vec[] = unit_vec[]
+    #endif
     memcpy(pl.position, target_steps, sizeof(target_steps)); // pl.position[] = target_steps[]
 
     //新的街区已经准备好了。更新缓冲头和下一个缓冲头索引。
@@ -422,7 +638,7 @@ uint8_t plan_buffer_line(float *target, plan_line_data_t *pl_data)
     next_buffer_head = plan_next_block_index(block_buffer_head);
 
     //最后，使用新块重新计算平面。
-    planner_recalculate();
+    planner_recalculate_added();
   }
   return(PLAN_OK);
 }
@@ -449,6 +665,16 @@ void plan_sync_position()
 }
 
 
+//返回规划器位置（最后一个块的终点），单位为mm。pl.position已经是笛卡尔坐标的步数，CoreXY不用换算。
+void plan_get_planner_mpos(float *target)
+{
+  uint8_t idx;
+  for (idx=0; idx<N_AXIS; idx++) {
+    target[idx] = pl.position[idx]/settings.steps_per_mm[idx];
+  }
+}
+
+
 //返回规划器缓冲区中的可用块数。
 uint8_t plan_get_block_buffer_available()
 {
@@ -473,5 +699,23 @@ void plan_cycle_reinitialize()
   // 从一个完成的停止点重新计划。 重置计划器输入速度和缓冲区计划指针。
   st_update_plan_block_parameters();
   block_buffer_planned = block_buffer_tail;
-  planner_recalculate();
+  planner_recalculate(0);
 }
+
+
+#ifdef PLANNER_DEFERRED_RECALCULATE
+  //完成被截断或推迟的重新规划。在主程序空闲时调用，例如等待规划器缓冲区空位或串口数据时。
+  void plan_recalculate_deferred()
+  {
+    if (recalculate_pending) { planner_recalculate(0); }
+  }
+#endif
+
+
+#ifdef ARC_BATCH_SEGMENTS
+  void plan_defer_recalculate(uint8_t defer)
+  {
+    recalculate_deferred = defer;
+    if (!defer) { plan_recalculate_deferred(); }
+  }
+#endif
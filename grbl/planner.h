@@ -43,6 +43,19 @@
 #define PL_COND_ACCESSORY_MASK (PL_COND_FLAG_SPINDLE_CW|PL_COND_FLAG_SPINDLE_CCW|PL_COND_FLAG_COOLANT_FLOOD|PL_COND_FLAG_COOLANT_MIST)
 
 
+#ifdef NATIVE_ARC_BLOCKS
+  //圆弧块的几何数据。mc_arc()填写后通过pl_data->arc传给规划器，直线块中全部为零。
+  typedef struct {
+    float r_axis0;        //从圆心到起点的半径向量（毫米）
+    float r_axis1;
+    float angular_travel; //圆弧角度（弧度），逆时针为正。非零表示圆弧块。
+    float linear_travel;  //螺旋运动中直线轴的行程（毫米）
+    uint8_t axis_0;       //圆弧平面的两个轴和螺旋运动的直线轴
+    uint8_t axis_1;
+    uint8_t axis_linear;
+  } plan_arc_t;
+#endif
+
 //此结构存储g代码块运动的线性运动，其临界“标称”值如源g代码中所规定。
 typedef struct {
 //bresenham算法用于跟踪直线的字段
@@ -73,6 +86,15 @@ typedef struct {
 //由主轴覆盖和恢复方法使用的存储主轴速度数据。
     float spindle_speed;//块主轴转速。从pl_line_data复制。
   #endif
+
+  #ifdef PLANNER_MERGE_COLLINEAR
+    float merge_deviation;//合并进此块的各线段端点到块直线的最大距离的上界（mm）
+  #endif
+
+  #ifdef NATIVE_ARC_BLOCKS
+//圆弧块由段准备沿圆弧插补，steps[]和direction_bits只是整个圆弧的净位移，step_event_count是按弧长换算的虚拟步数。
+    plan_arc_t arc;
+  #endif
 } plan_block_t;
 
 
@@ -84,6 +106,12 @@ typedef struct {
   #ifdef USE_LINE_NUMBERS
     int32_t line_number;//执行时要报告的所需行号。
   #endif
+  #ifdef NATIVE_ARC_BLOCKS
+    plan_arc_t *arc;//不为NULL时，运动是从当前位置到目标位置的圆弧。
+  #endif
+  #ifdef PATH_BLENDING
+    float blend_tolerance;//大于零时，mc_line()用不超过此距离（mm）的曲线与下一条直线的拐角混合。
+  #endif
 } plan_line_data_t;
 
 
@@ -124,6 +152,22 @@ void plan_sync_position();
 //使用部分完成的块重新初始化计划
 void plan_cycle_reinitialize();
 
+//截断或批量加入块时，重新规划会被推迟。
+#if defined(PLANNER_RECALCULATE_LIMIT) || defined(ARC_BATCH_SEGMENTS)
+  #define PLANNER_DEFERRED_RECALCULATE
+#endif
+
+#ifdef PLANNER_DEFERRED_RECALCULATE
+  //完成被推迟的重新规划。由主程序在空闲时调用。
+  void plan_recalculate_deferred();
+#endif
+
+#ifdef ARC_BATCH_SEGMENTS
+  //设置为true后，plan_buffer_line()加入块时不重新规划，直到调用plan_recalculate_deferred()或再设置为false。
+  //新块的进入速度为零，推迟期间的计划始终是安全的。复位时清除。
+  void plan_defer_recalculate(uint8_t defer);
+#endif
+
 //返回规划器缓冲区中的可用块数。
 uint8_t plan_get_block_buffer_available();
 
@@ -134,6 +178,7 @@ uint8_t plan_get_block_buffer_count();
 //返回块环形缓冲区的状态。如果缓冲区已满，则为True。
 uint8_t plan_check_full_buffer();
 
+//返回规划器位置（最后一个块的终点），单位为mm。
 void plan_get_planner_mpos(float *target);
 
 
@@ -22,9 +22,29 @@
 
 static char line[LINE_BUFFER_SIZE]; // 被执行的行。以零为结束符。
 
+#ifdef REPORT_RX_CREDIT
+  static uint8_t rx_credit_low; // 上次推送之后接收缓冲区可用空间的最低点
+#endif
+
 static void protocol_exec_rt_suspend();
 
 
+#ifdef REPORT_RX_CREDIT
+  // 接收缓冲区可用空间比最低点多出RX_CREDIT_REPORT_STEP时推送。在主循环取走数据之后调用。
+  // 注：以最低点为基准而不是固定的水位线，数据逐字节到达时不会在水位线附近反复推送。
+  static void protocol_check_rx_credit()
+  {
+    uint8_t available = serial_get_rx_buffer_available();
+    if (available < rx_credit_low) {
+      rx_credit_low = available; // 空间减少时只记录，不推送。
+    } else if (available-rx_credit_low >= RX_CREDIT_REPORT_STEP) {
+      report_rx_credit(available);
+      rx_credit_low = available;
+    }
+  }
+#endif
+
+
 /*
   GRBL 主循环:
 */
@@ -62,13 +82,27 @@ void protocol_main_loop()
   // 这也是Grbl空闲等待其他事情的地方。
   // ---------------------------------------------------------------------------------
 
+  #ifdef REPORT_RX_CREDIT
+    rx_credit_low = RX_BUFFER_SIZE; // 复位后接收缓冲区为空
+  #endif
+
   uint8_t line_flags = 0; // 初始化行标志位
   uint8_t char_counter = 0; // 初始化字符计数
+  #ifdef STREAMING_TOKENIZER
+    gc_tokenizer_reset();
+  #endif
   uint8_t c; // 声明放字符的变量
   for (;;) { // 无限循环
 
     // 处理一行从串口缓冲区到来的数据，如果数据可用的话。通过溢出空格和注释执行一个初始的过滤，并且大写所有字母。
     while((c = serial_read()) != SERIAL_NO_DATA) { // 从串口读取一个字节，直到遇到结束符
+      #ifdef BINARY_STREAMING
+        if (c == CMD_BINARY_BLOCK) { // 二进制块帧。与G代码行互不影响。
+          binary_execute_block();
+          if (sys.abort) { return; } // 系统终止后退出函数
+          continue;
+        }
+      #endif
       if ((c == '\n') || (c == '\r')) { // 到达一行
 
         protocol_execute_realtime(); // 运行时命令检查点
@@ -88,18 +122,33 @@ void protocol_main_loop()
           report_status_message(STATUS_OK);
         } else if (line[0] == '$') {
           // Grbl 系统命令 '$'
+          #ifdef PATH_BLENDING
+            mc_blend_flush(); // 点动、归位和设置都从规划器位置开始。
+            if (sys.abort) { return; }
+          #endif
           report_status_message(system_execute_line(line));
         } else if (sys.state & (STATE_ALARM | STATE_JOG)) {
           // 其他的都是G代码。如果处于警报或点动模式就阻塞。
           report_status_message(STATUS_SYSTEM_GC_LOCK);
         } else {
           // 解析并执行G代码块。
-          report_status_message(gc_execute_line(line));
+          #ifdef STREAMING_TOKENIZER
+            report_status_message(gc_execute_tokenized_line(line));
+          #else
+            report_status_message(gc_execute_line(line));
+          #endif
         }
 
         // 为下一行重置跟踪数据变量
         line_flags = 0;
         char_counter = 0;
+        #ifdef STREAMING_TOKENIZER
+          gc_tokenizer_reset();
+        #endif
+
+        #ifdef REPORT_RX_CREDIT
+          protocol_check_rx_credit(); // 执行完一行后，新空出的空间
+        #endif
 
       } else {
 
@@ -133,10 +182,12 @@ void protocol_main_loop()
           } else if (char_counter >= (LINE_BUFFER_SIZE-1)) {
             // 检查行缓冲区溢出并设置标志位。
             line_flags |= LINE_FLAG_OVERFLOW;
-          } else if (c >= 'a' && c <= 'z') { // 字母改成大写
-            line[char_counter++] = c-'a'+'A';
           } else {
+            if (c >= 'a' && c <= 'z') { c -= 'a'-'A'; } // 字母改成大写
             line[char_counter++] = c;
+            #ifdef STREAMING_TOKENIZER
+              gc_tokenizer_add(c); // 边组装边识别g代码字
+            #endif
           }
         }
 
@@ -144,6 +195,22 @@ void protocol_main_loop()
     }
 
 
+    #ifdef REPORT_RX_CREDIT
+      protocol_check_rx_credit(); // 接收缓冲区已取空
+    #endif
+
+    #ifdef PLANNER_DEFERRED_RECALCULATE
+      plan_recalculate_deferred(); // 没有数据要处理，完成被截断的重新规划。
+    #endif
+
+    #ifdef PATH_BLENDING
+      // 规划器只剩正在执行的块时送出留下的直线，不必等到机器停下。
+      if (plan_get_block_buffer_available() >= BLOCK_BUFFER_SIZE-2) {
+        mc_blend_flush();
+        if (sys.abort) { return; }
+      }
+    #endif
+
     // 如果在串口读缓冲区没有字符需要处理或执行，这会通知g代码流已填充到规划器缓冲区或已完成。
     // 不管哪种情况，如果开启了自动循环，就会开始自动循环，队列就会移动。
     protocol_auto_cycle_start();
@@ -159,8 +226,14 @@ void protocol_main_loop()
 // 阻塞直到所有缓冲的步数被执行或处于循环状态。同步期间，进给保持时可能会发生。并且等待循环结束。
 void protocol_buffer_synchronize()
 {
+  #ifdef PATH_BLENDING
+    mc_blend_flush(); // 留下的直线也要执行完。
+  #endif
   // 如果系统进入队列，确保循环继续如果自动循环标志位提供了。
   protocol_auto_cycle_start();
+  #ifdef PLANNER_DEFERRED_RECALCULATE
+    plan_recalculate_deferred(); // 不会再有新块，完成剩下的规划。
+  #endif
   do {
     protocol_execute_realtime();   // 检查并执行运行时命令。
     if (sys.abort) { return; } // 检查系统是否终止
@@ -473,6 +546,13 @@ void protocol_exec_rt_system()
     }
   #endif
 
+  #ifdef ISR_PROFILE
+    if (sys_rt_exec_isr_profile) {
+      report_isr_profile();
+      sys_rt_exec_isr_profile = 0;
+    }
+  #endif
+
   //重新加载步进段缓冲区
   if (sys.state & (STATE_CYCLE | STATE_HOLD | STATE_SAFETY_DOOR | STATE_HOMING | STATE_SLEEP| STATE_JOG)) {
     st_prep_buffer();
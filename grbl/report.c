@@ -65,6 +65,8 @@ static void report_util_setting_string(uint8_t n) {
     case 30: printPgmString(PSTR("rpm max")); break;
     case 31: printPgmString(PSTR("rpm min")); break;
     case 32: printPgmString(PSTR("laser")); break;
+    case 38: printPgmString(PSTR("amass hz")); break;
+    case 39: printPgmString(PSTR("amass lvl")); break;
     default:
       n -= AXIS_SETTINGS_START_VAL;
       uint8_t idx = 0;
@@ -200,6 +202,10 @@ void report_grbl_settings() {
   #else
     report_util_uint8_setting(32,0);
   #endif
+  #ifdef AMASS_RUNTIME_CUTOFFS
+    report_util_float_setting(38,settings.amass_cutoff,0);
+    report_util_uint8_setting(39,settings.amass_max_level);
+  #endif
   //打印轴设置
   uint8_t idx, set_idx;
   uint8_t val = AXIS_SETTINGS_START_VAL;
@@ -288,6 +294,13 @@ void report_gcode_modes()
   report_util_gcode_modes_G();
   print_uint8_base10(94-gc_state.modal.feed_rate);
 
+  #ifdef PATH_BLENDING
+    if (gc_state.modal.control == CONTROL_MODE_BLEND) {
+      report_util_gcode_modes_G();
+      print_uint8_base10(64);
+    }
+  #endif
+
   if (gc_state.modal.program_flow) {
     report_util_gcode_modes_M();
     switch (gc_state.modal.program_flow) {
@@ -430,6 +443,9 @@ void report_build_info(char *line)
   #ifdef ENABLE_DUAL_AXIS
     serial_write('2');
   #endif
+  #ifdef BINARY_STREAMING
+    serial_write('B');
+  #endif
   //注意：编译后的值，如覆盖增量/最大/最小值，可能会在以后的某个时间添加。
   serial_write(',');
   print_uint8_base10(BLOCK_BUFFER_SIZE-1);
@@ -525,6 +541,15 @@ void report_realtime_status()
     }
   #endif
 
+  #ifdef REPORT_SEGMENT_UNDERRUNS
+    //段缓冲区欠载次数。为0时不输出。
+    uint16_t underruns = st_get_segment_underruns();
+    if (underruns > 0) {
+      printPgmString(PSTR("|Un:"));
+      print_uint32_base10(underruns);
+    }
+  #endif
+
   #ifdef USE_LINE_NUMBERS
     #ifdef REPORT_FIELD_LINE_NUMBERS
       //报告当前行号
@@ -648,3 +673,86 @@ void report_realtime_status()
 
   }
 #endif
+
+
+#ifdef REPORT_RX_CREDIT
+  //接收缓冲区可用空间越过水位线时主动发送，格式为“[RX:可用字节数]”。
+  void report_rx_credit(uint8_t available)
+  {
+    printPgmString(PSTR("[RX:"));
+    print_uint8_base10(available);
+    report_util_feedback_line_feed();
+  }
+#endif
+
+
+#ifdef BINARY_STREAMING
+  //二进制块帧已取走。status_code不为零时表示被拒绝，含义与'error:'相同。
+  void report_binary_ack(uint8_t seq, uint8_t status_code)
+  {
+    printPgmString(PSTR("[ACK:"));
+    print_uint8_base10(seq);
+    if (status_code != STATUS_OK) {
+      serial_write(',');
+      print_uint8_base10(status_code);
+    }
+    report_util_feedback_line_feed();
+  }
+
+  //二进制块帧校验失败或序号不连续。seq是期望的序号。
+  void report_binary_nak(uint8_t seq)
+  {
+    printPgmString(PSTR("[NAK:"));
+    print_uint8_base10(seq);
+    report_util_feedback_line_feed();
+  }
+#endif
+
+
+#ifdef ISR_PROFILE
+  //打印中断执行时间统计，单位为CPU周期。每个分项一行：[ISR:名称,最短,平均,最长,次数]，
+  //最后一行是步进中断总时间的直方图，每格64个周期，最后一格是512个周期以上。
+  //测量的限制：不启用AMASS时，慢速段的定时器1使用8或64分频，读数按8或64个周期量化。步进中断开中断后，
+  //嵌套的串口接收中断的时间已经减去，但它进出中断的几十个周期和步进脉冲复位中断（定时器0溢出）的时间仍计入LOAD、BRES和STEP。
+  void report_isr_profile()
+  {
+    isr_profile_t profile[ISR_PROFILE_N];
+    uint16_t histogram[ISR_PROFILE_HISTOGRAM_SIZE];
+    uint8_t sreg = SREG;
+    cli(); //复制一份，避免打印期间被中断修改。
+    memcpy(profile, isr_profile, sizeof(profile));
+    memcpy(histogram, isr_profile_histogram, sizeof(histogram));
+    SREG = sreg;
+
+    uint8_t idx;
+    for (idx=0; idx<ISR_PROFILE_N; idx++) {
+      printPgmString(PSTR("[ISR:"));
+      switch (idx) {
+        case ISR_PROFILE_STEP_PULSE: printPgmString(PSTR("PULSE")); break;
+        case ISR_PROFILE_STEP_LOAD: printPgmString(PSTR("LOAD")); break;
+        case ISR_PROFILE_STEP_BRESENHAM: printPgmString(PSTR("BRES")); break;
+        case ISR_PROFILE_STEP_TOTAL: printPgmString(PSTR("STEP")); break;
+        case ISR_PROFILE_SERIAL_RX: printPgmString(PSTR("RX")); break;
+      }
+      if (profile[idx].count == 0) {
+        printPgmString(PSTR(",0,0,0,0"));
+      } else {
+        serial_write(',');
+        print_uint32_base10(profile[idx].min);
+        serial_write(',');
+        print_uint32_base10(profile[idx].sum/profile[idx].count);
+        serial_write(',');
+        print_uint32_base10(profile[idx].max);
+        serial_write(',');
+        print_uint32_base10(profile[idx].count);
+      }
+      report_util_feedback_line_feed();
+    }
+    printPgmString(PSTR("[ISR:HIST"));
+    for (idx=0; idx<ISR_PROFILE_HISTOGRAM_SIZE; idx++) {
+      serial_write(',');
+      print_uint32_base10(histogram[idx]);
+    }
+    report_util_feedback_line_feed();
+  }
+#endif
@@ -53,6 +53,7 @@
 #define STATUS_GCODE_UNUSED_WORDS 36
 #define STATUS_GCODE_G43_DYNAMIC_AXIS_ERROR 37
 #define STATUS_GCODE_MAX_VALUE_EXCEEDED 38
+#define STATUS_GCODE_VALUE_WORD_CONFLICT 39
 
 //定义Grbl报警代码。有效值（1-255）。0是保留的。
 #define ALARM_HARD_LIMIT_ERROR      EXEC_ALARM_HARD_LIMIT
@@ -122,4 +123,20 @@ void report_build_info(char *line);
   void report_realtime_debug();
 #endif
 
+#ifdef REPORT_RX_CREDIT
+  //推送接收缓冲区可用空间
+  void report_rx_credit(uint8_t available);
+#endif
+
+#ifdef BINARY_STREAMING
+  //二进制块帧的应答
+  void report_binary_ack(uint8_t seq, uint8_t status_code);
+  void report_binary_nak(uint8_t seq);
+#endif
+
+#ifdef ISR_PROFILE
+  //打印中断执行时间统计
+  void report_isr_profile();
+#endif
+
 #endif
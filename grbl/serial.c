@@ -25,6 +25,11 @@ uint8_t serial_tx_buffer[TX_RING_BUFFER]; // 定义串口发送环形队列
 uint8_t serial_tx_buffer_head = 0; // 定义串口发送环形队列头指针
 volatile uint8_t serial_tx_buffer_tail = 0; // 定义串口发送环形队列尾指针
 
+#ifdef BINARY_STREAMING
+  static volatile uint8_t serial_rx_binary_count; // 当前二进制帧还没有收到的字节数
+  static volatile uint8_t serial_rx_binary_discard; // 复位时正在接收的帧，其余字节丢弃
+#endif
+
 
 // 返回串口读缓冲区可用字节数。
 uint8_t serial_get_rx_buffer_available()
@@ -41,7 +46,7 @@ uint8_t serial_get_rx_buffer_count()
 {
   uint8_t rtail = serial_rx_buffer_tail; // 临时变量暂存尾指针优化volatile
   if (serial_rx_buffer_head >= rtail) { return(serial_rx_buffer_head-rtail); }
-  return (RX_BUFFER_SIZE - (rtail-serial_rx_buffer_head));
+  return (RX_RING_BUFFER - (rtail-serial_rx_buffer_head));
 }
 
 
@@ -135,12 +140,33 @@ uint8_t serial_read()
   }
 }
 
+// 写入到接收缓冲区，直到它满了为止。在接收中断中调用。
+static inline void serial_rx_buffer_write(uint8_t data)
+{
+  uint8_t next_head = serial_rx_buffer_head + 1; // 更新临时头指针
+  if (next_head == RX_RING_BUFFER) { next_head = 0; }
+
+  if (next_head != serial_rx_buffer_tail) {
+    serial_rx_buffer[serial_rx_buffer_head] = data;
+    serial_rx_buffer_head = next_head;
+  }
+}
+
 // 串口数据接收中断处理
 ISR(SERIAL_RX)
 {
+  #ifdef ISR_PROFILE
+    uint16_t profile_start = st_profile_timestamp();
+  #endif
   uint8_t data = UDR0; // 从串口数据寄存器取出数据
-  uint8_t next_head; // 初始化下一个头指针
 
+  #ifdef BINARY_STREAMING
+    // 二进制帧的数据原样写入接收缓冲区，不当作实时命令。
+    if (serial_rx_binary_count) {
+      serial_rx_binary_count--;
+      if (!serial_rx_binary_discard) { serial_rx_buffer_write(data); }
+    } else
+  #endif
   // 直接从串行流中选取实时命令字符。这些字符不被传递到主缓冲区，但是它们设置了实时执行的系统状态标志位。
   switch (data) {
     case CMD_RESET:         mc_reset(); break; // 调用运动控制重置程序
@@ -159,6 +185,22 @@ ISR(SERIAL_RX)
           #ifdef DEBUG
             case CMD_DEBUG_REPORT: {uint8_t sreg = SREG; cli(); bit_true(sys_rt_exec_debug,EXEC_DEBUG_REPORT); SREG = sreg;} break;
           #endif
+          #ifdef BINARY_STREAMING
+            case CMD_BINARY_BLOCK: // 起始字节写入缓冲区，主循环据此读取整帧。
+              serial_rx_binary_count = BINARY_FRAME_SIZE;
+              // 缓冲区放不下整帧时丢弃整帧，不写入起始字节，以免只写入一部分字节使后面的数据错位。
+              // 下一帧序号不连续，主循环据此发送NAK。
+              if (serial_get_rx_buffer_available() > BINARY_FRAME_SIZE) {
+                serial_rx_buffer_write(data);
+                serial_rx_binary_discard = false;
+              } else {
+                serial_rx_binary_discard = true;
+              }
+              break;
+          #endif
+          #ifdef ISR_PROFILE
+            case CMD_ISR_PROFILE_REPORT: bit_true(sys_rt_exec_isr_profile,EXEC_ISR_PROFILE_REPORT); break; // 本中断中已关中断
+          #endif
           // 以下为实时覆盖命令
           case CMD_FEED_OVR_RESET: system_set_exec_motion_override_flag(EXEC_FEED_OVR_RESET); break;
           case CMD_FEED_OVR_COARSE_PLUS: system_set_exec_motion_override_flag(EXEC_FEED_OVR_COARSE_PLUS); break;
@@ -181,20 +223,25 @@ ISR(SERIAL_RX)
         }
         // 除了上面已知的实时命令，其他的ASCII扩展字符都被丢掉
       } else { // 其他的字符被认为都是G代码，会被写入到主缓冲区
-        next_head = serial_rx_buffer_head + 1; // 更新临时头指针
-        if (next_head == RX_RING_BUFFER) { next_head = 0; }
-
-        // 写入到接收缓冲区，直到它满了为止。
-        if (next_head != serial_rx_buffer_tail) {
-          serial_rx_buffer[serial_rx_buffer_head] = data;
-          serial_rx_buffer_head = next_head;
-        }
+        serial_rx_buffer_write(data);
       }
   }
+  #ifdef ISR_PROFILE
+    uint16_t profile_cycles = st_profile_cycles(profile_start, st_profile_timestamp());
+    st_profile_record(ISR_PROFILE_SERIAL_RX, profile_cycles);
+    isr_profile_nested += profile_cycles; //本中断中已关中断
+  #endif
 }
 
 // 重置并清空串口读缓冲区数据。用于急停和重置。
 void serial_reset_read_buffer()
 {
   serial_rx_buffer_tail = serial_rx_buffer_head;
+  #ifdef BINARY_STREAMING
+    // 正在接收的帧的起始字节已被清除，其余字节不能当作G代码或实时命令，只能丢弃。
+    uint8_t sreg = SREG;
+    cli();
+    if (serial_rx_binary_count) { serial_rx_binary_discard = true; }
+    SREG = sreg;
+  #endif
 }
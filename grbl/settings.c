@@ -31,6 +31,10 @@ const __flash settings_t defaults = {\
     .homing_seek_rate = DEFAULT_HOMING_SEEK_RATE,
     .homing_debounce_delay = DEFAULT_HOMING_DEBOUNCE_DELAY,
     .homing_pulloff = DEFAULT_HOMING_PULLOFF,
+    #ifdef AMASS_RUNTIME_CUTOFFS
+      .amass_cutoff = DEFAULT_AMASS_CUTOFF,
+      .amass_max_level = DEFAULT_AMASS_MAX_LEVEL,
+    #endif
     .flags = (DEFAULT_REPORT_INCHES << BIT_REPORT_INCHES) | \
              (DEFAULT_LASER_MODE << BIT_LASER_MODE) | \
              (DEFAULT_INVERT_ST_ENABLE << BIT_INVERT_ST_ENABLE) | \
@@ -287,6 +291,19 @@ uint8_t settings_store_global_setting(uint8_t parameter, float value) {
           return(STATUS_SETTING_DISABLED_LASER);
         #endif
         break;
+      #ifdef AMASS_RUNTIME_CUTOFFS
+        case 38:
+          //第0级的每步周期数必须装得下16位定时器，第1级的中断频率不能超过AMASS_MAX_CUTOFF的两倍。
+          if (value > AMASS_MAX_CUTOFF) { return(STATUS_MAX_STEP_RATE_EXCEEDED); }
+          if (value < (F_CPU >> 16)+1) { return(STATUS_INVALID_STATEMENT); }
+          settings.amass_cutoff = trunc(value);
+          st_generate_amass_cutoff();
+          break;
+        case 39:
+          if ((int_value < 1) || (int_value > MAX_AMASS_LEVEL)) { return(STATUS_INVALID_STATEMENT); }
+          settings.amass_max_level = int_value;
+          break;
+      #endif
       default:
         return(STATUS_INVALID_STATEMENT);
     }
@@ -311,6 +328,15 @@ uint8_t get_step_pin_mask(uint8_t axis_idx)
 {
   if ( axis_idx == X_AXIS ) { return((1<<X_STEP_BIT)); }
   if ( axis_idx == Y_AXIS ) { return((1<<Y_STEP_BIT)); }
+  #if N_AXIS > 3
+    if ( axis_idx == A_AXIS ) { return((1<<A_STEP_BIT)); }
+  #endif
+  #if N_AXIS > 4
+    if ( axis_idx == B_AXIS ) { return((1<<B_STEP_BIT)); }
+  #endif
+  #if N_AXIS > 5
+    if ( axis_idx == C_AXIS ) { return((1<<C_STEP_BIT)); }
+  #endif
   return((1<<Z_STEP_BIT));
 }
 
@@ -320,6 +346,15 @@ uint8_t get_direction_pin_mask(uint8_t axis_idx)
 {
   if ( axis_idx == X_AXIS ) { return((1<<X_DIRECTION_BIT)); }
   if ( axis_idx == Y_AXIS ) { return((1<<Y_DIRECTION_BIT)); }
+  #if N_AXIS > 3
+    if ( axis_idx == A_AXIS ) { return((1<<A_DIRECTION_BIT)); }
+  #endif
+  #if N_AXIS > 4
+    if ( axis_idx == B_AXIS ) { return((1<<B_DIRECTION_BIT)); }
+  #endif
+  #if N_AXIS > 5
+    if ( axis_idx == C_AXIS ) { return((1<<C_DIRECTION_BIT)); }
+  #endif
   return((1<<Z_DIRECTION_BIT));
 }
 
@@ -100,6 +100,11 @@ typedef struct {
   float homing_seek_rate;
   uint16_t homing_debounce_delay;
   float homing_pulloff;
+
+  #ifdef AMASS_RUNTIME_CUTOFFS
+    uint16_t amass_cutoff;    //AMASS第1级截止频率（Hz）
+    uint8_t amass_max_level;  //使用的最高AMASS级别
+  #endif
 } settings_t;
 extern settings_t settings;
 
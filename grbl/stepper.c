@@ -28,6 +28,18 @@
 #define PREP_FLAG_PARKING bit(2)
 #define PREP_FLAG_DECEL_OVERRIDE bit(3)
 
+#ifdef ST_PREP_FIXED_POINT
+  //定点数段准备的单位：距离为1/256步，时间为1/256段，速度为1/65536步每段，加速度为1/65536步每段平方。
+  #define ST_FX_DIST_SHIFT 8
+  #define ST_FX_DIST_MASK ((1UL<<ST_FX_DIST_SHIFT)-1)
+  #define ST_FX_TIME_SHIFT 8
+  #define ST_FX_TIME_MASK ((1UL<<ST_FX_TIME_SHIFT)-1)
+  #define ST_FX_SPEED_SHIFT 16
+  #define ST_FX_SEGMENT (1UL<<ST_FX_TIME_SHIFT) // 一个DT_SEGMENT
+  #define ST_FX_REQ_INCREMENT ((uint32_t)(REQ_MM_INCREMENT_SCALAR*(1UL<<ST_FX_DIST_SHIFT)))
+  #define ST_FX_CYCLES_PER_SEGMENT (F_CPU/ACCELERATION_TICKS_PER_SECOND)
+#endif
+
 //定义自适应多轴步进平滑（AMASS）级别和截止频率。
 //最高电平频率槽开始于0Hz，结束于其截止频率。
 //下一个低电平频率单元从下一个高截止频率开始，依此类推。
@@ -35,7 +47,9 @@
 //0级（无AMASS，正常运行）频率槽从1级截止频率开始，并以CPU允许的最快速度（在有限测试中超过30kHz）。
 //注：AMASS截止频率乘以ISR超速驱动系数不得超过最大步进频率。
 //注意：当前设置将ISR超速驱动至不超过16kHz，以平衡CPU开销和计时器精度。除非您知道自己在做什么，否则不要更改这些设置。
-#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+#ifdef AMASS_RUNTIME_CUTOFFS
+  //级别数在stepper.h中定义。第1级截止频率由$38设置，每高一级减半，最高使用到$39级。
+#elif defined(ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING)
 	#define MAX_AMASS_LEVEL 3
 	//AMASS_LEVEL0：正常运行。没有积累。没有上限截止频率。从1级截止频率开始。
 	#define AMASS_LEVEL1 (F_CPU/8000) //Over-drives ISR（x2）。定义为F_CPU/（截止频率，单位为Hz）
@@ -65,13 +79,20 @@ typedef struct {
 } st_block_t;
 static st_block_t st_block_buffer[SEGMENT_BUFFER_SIZE-1];
 
+//段缓冲区和步进块数据的索引。超过255个段时改为16位。
+#if SEGMENT_BUFFER_SIZE > 255
+  typedef uint16_t segment_index_t;
+#else
+  typedef uint8_t segment_index_t;
+#endif
+
 //主步进段环形缓冲区。
 //包含用于执行步进算法的小而短的线段，这些线段从planner缓冲区中的第一个块开始递增“签出”。
 //一旦“签出”，规划器就不能修改段缓冲区中的步，剩余的规划器块步仍然可以修改。
 typedef struct {
   uint16_t n_step;           //要为此段执行的步事件数
   uint16_t cycles_per_tick;  //ISR周期移动的步距，也称为步率。
-  uint8_t  st_block_index;   //步进块数据索引。使用此信息执行此段。
+  segment_index_t st_block_index; //步进块数据索引。使用此信息执行此段。
   #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
     uint8_t AMASS_level;    //指示ISR执行此段的AMASS级别
   #else
@@ -86,9 +107,7 @@ static segment_t segment_buffer[SEGMENT_BUFFER_SIZE];
 //步进ISR数据结构。包含主步进电机ISR的运行数据。
 typedef struct {
   //由bresenham直线算法使用
-  uint32_t counter_x,        //bresenham线跟踪器的计数器变量
-           counter_y,
-           counter_z;
+  uint32_t counter[N_AXIS]; //bresenham线跟踪器的计数器变量
   #ifdef STEP_PULSE_DELAY
     uint8_t step_bits;  //存储out_bits输出以完成步进脉冲延迟
   #endif
@@ -106,16 +125,42 @@ typedef struct {
   #endif
 
   uint16_t step_count;       //直线段运动中的剩余步数
-  uint8_t exec_block_index; //跟踪当前st_block索引。更改表示新块。
+  segment_index_t exec_block_index; //跟踪当前st_block索引。更改表示新块。
   st_block_t *exec_block;   //指向正在执行的段的块数据的指针
   segment_t *exec_segment;  //指向正在执行的段的指针
 } stepper_t;
 static stepper_t st;
 
 //步进段环形缓冲区索引
-static volatile uint8_t segment_buffer_tail;
-static uint8_t segment_buffer_head;
-static uint8_t segment_next_head;
+static volatile segment_index_t segment_buffer_tail;
+static segment_index_t segment_buffer_head;
+static segment_index_t segment_next_head;
+
+#ifdef REPORT_SEGMENT_UNDERRUNS
+  static uint16_t segment_underrun_count; //运动中途段缓冲区变空的次数
+  static volatile uint8_t prep_block_pending; //段准备发布：还有块没有准备完，段缓冲区变空就是欠载
+#endif
+
+//主程序读取尾部索引、发布头部索引。环形缓冲区只有一个生产者（主程序）和一个消费者（步进中断），不需要加锁，
+//但AVR一次只能读写8位：16位的尾部索引读两次直到相同，头部索引在写入时短暂关中断，防止中断看到写了一半的值。
+#if SEGMENT_BUFFER_SIZE > 255
+  static segment_index_t st_segment_buffer_tail()
+  {
+    segment_index_t tail;
+    do { tail = segment_buffer_tail; } while (tail != segment_buffer_tail);
+    return(tail);
+  }
+  static void st_publish_segment_buffer_head(segment_index_t head)
+  {
+    uint8_t sreg = SREG;
+    cli();
+    segment_buffer_head = head;
+    SREG = sreg;
+  }
+#else
+  #define st_segment_buffer_tail() (segment_buffer_tail)
+  #define st_publish_segment_buffer_head(head) (segment_buffer_head = (head))
+#endif
 
 // 步进和方向端口反转掩码
 static uint8_t step_port_invert_mask;
@@ -125,9 +170,19 @@ static uint8_t dir_port_invert_mask;
   static uint8_t dir_port_invert_mask_dual;
 #endif
 
+#ifdef AMASS_RUNTIME_CUTOFFS
+  static uint32_t amass_cutoff_cycles; //第1级截止频率，F_CPU/$38。每高一级加倍。
+#endif
+
 // 用于避免“步进驱动程序中断”的ISR嵌套。但这应该永远不会发生。
 static volatile uint8_t busy;
 
+#ifdef ISR_PROFILE
+  isr_profile_t isr_profile[ISR_PROFILE_N];
+  uint16_t isr_profile_histogram[ISR_PROFILE_HISTOGRAM_SIZE];
+  volatile uint16_t isr_profile_nested;
+#endif
+
 //从规划器缓冲区准备的步进段的指针。只能由主程序访问。
 //指针可能是计划段或计划块，位于执行的内容之前。
 static plan_block_t *pl_block;     //指向正在准备的计划程序块的指针
@@ -136,19 +191,34 @@ static st_block_t *st_prep_block;  //指向正在准备的步进程序块数据
 //准备段数据结构。
 //包含根据当前执行的规划器块计算新线段所需的所有信息。
 typedef struct {
-  uint8_t st_block_index;  //正在准备的步进机公用数据块的索引
+  segment_index_t st_block_index;  //正在准备的步进机公用数据块的索引
   uint8_t recalculate_flag;
 
-  float dt_remainder;
-  float steps_remaining;
+  #ifdef ST_PREP_FIXED_POINT
+    uint32_t dt_remainder;    //上一段部分步的执行时间（CPU周期）
+    uint32_t steps_remaining; //向上取整的剩余步数（1/256步）
+  #else
+    float dt_remainder;
+    float steps_remaining;
+  #endif
   float step_per_mm;
   float req_mm_increment;
 
   #ifdef PARKING_ENABLE
-    uint8_t last_st_block_index;
-    float last_steps_remaining;
+    segment_index_t last_st_block_index;
     float last_step_per_mm;
-    float last_dt_remainder;
+    #ifdef ST_PREP_FIXED_POINT
+      uint32_t last_steps_remaining;
+      uint32_t last_dt_remainder;
+      uint32_t last_fx_remaining;
+    #else
+      float last_steps_remaining;
+      float last_dt_remainder;
+    #endif
+    #ifdef NATIVE_ARC_BLOCKS
+      int32_t last_arc_steps[N_AXIS];
+      uint8_t last_arc_block_used;
+    #endif
   #endif
 
   uint8_t ramp_type;      //当前段斜坡状态
@@ -160,6 +230,37 @@ typedef struct {
   float accelerate_until; //从块端测量的加速度斜坡端（毫米）
   float decelerate_after; //减速坡道起点从挡块末端测量（毫米）
 
+  #ifdef ST_PREP_FIXED_POINT
+    //上面速度剖面的定点数副本，每次计算速度剖面时换算。段准备只使用这些值。
+    uint32_t fx_remaining;        //到块末端的精确距离，与pl_block->millimeters对应
+    uint32_t fx_complete;
+    uint32_t fx_accelerate_until;
+    uint32_t fx_decelerate_after;
+    uint32_t fx_current_speed;
+    uint32_t fx_maximum_speed;
+    uint32_t fx_exit_speed;
+    uint32_t fx_acceleration;
+    uint8_t fx_distance_carry;    //上一段距离舍入掉的小数部分
+    uint8_t fx_time_carry;        //上一个斜坡结点时间舍入掉的小数部分
+    float fx_inv_speed_scale;     //定点速度换算为毫米/分钟
+    float mm_per_fx;              //定点距离换算为毫米
+  #endif
+
+  #ifdef S_CURVE_PROFILE
+    float ramp_time;      //当前S形斜坡已经过的时间（分钟）
+    float ramp_duration;  //当前S形斜坡的总时间（分钟）
+    float ramp_speed;     //斜坡起点速度（毫米/分钟）
+    float ramp_delta;     //斜坡的速度变化，减速时为负（毫米/分钟）
+    float ramp_accel;     //斜坡起点的加速度（毫米/分钟^2）。重新计算剖面时从正在进行的斜坡继承。
+    float ramp_mm;        //斜坡起点到块末端的距离（毫米）
+    float ramp_end_mm;    //斜坡终点到块末端的距离（毫米）
+  #endif
+
+  #ifdef NATIVE_ARC_BLOCKS
+    int32_t arc_steps[N_AXIS]; //圆弧块已经准备的弦相对块起点的步数
+    uint8_t arc_block_used;    //当前步进块数据已被段使用，圆弧的下一条弦要使用新的步进块数据
+  #endif
+
   #ifdef VARIABLE_SPINDLE
     float inv_rate;    //PWM激光模式用于加速分段计算。
     uint8_t current_spindle_pwm; 
@@ -250,6 +351,72 @@ void st_go_idle()
 }
 
 
+//按轴索引排列的步进位和方向位。只用常数下标访问，编译时折叠为立即数。
+//N_AXIS大于3时，cpu_map.h需要为A、B、C轴定义A_STEP_BIT、A_DIRECTION_BIT等，并加入STEP_MASK和DIRECTION_MASK。
+static const uint8_t st_step_bit[N_AXIS] = {
+  X_STEP_BIT, Y_STEP_BIT, Z_STEP_BIT,
+  #if N_AXIS > 3
+    A_STEP_BIT,
+  #endif
+  #if N_AXIS > 4
+    B_STEP_BIT,
+  #endif
+  #if N_AXIS > 5
+    C_STEP_BIT,
+  #endif
+};
+static const uint8_t st_direction_bit[N_AXIS] = {
+  X_DIRECTION_BIT, Y_DIRECTION_BIT, Z_DIRECTION_BIT,
+  #if N_AXIS > 3
+    A_DIRECTION_BIT,
+  #endif
+  #if N_AXIS > 4
+    B_DIRECTION_BIT,
+  #endif
+  #if N_AXIS > 5
+    C_DIRECTION_BIT,
+  #endif
+};
+
+//对每个轴展开一次action(idx)。下标是常数，不是循环，3轴时编译结果与原来手写的X、Y、Z三份代码相同。
+#if N_AXIS > 3
+  #define ST_AXIS_A(action) action(A_AXIS);
+#else
+  #define ST_AXIS_A(action)
+#endif
+#if N_AXIS > 4
+  #define ST_AXIS_B(action) action(B_AXIS);
+#else
+  #define ST_AXIS_B(action)
+#endif
+#if N_AXIS > 5
+  #define ST_AXIS_C(action) action(C_AXIS);
+#else
+  #define ST_AXIS_C(action)
+#endif
+#define ST_FOR_EACH_AXIS(action) { action(X_AXIS); action(Y_AXIS); action(Z_AXIS); ST_AXIS_A(action) ST_AXIS_B(action) ST_AXIS_C(action) }
+
+//一个轴的Bresenham更新：计数器超过步事件数时输出一步并更新机器位置。
+static inline void st_bresenham_axis(const uint8_t idx) __attribute__((always_inline));
+static inline void st_bresenham_axis(const uint8_t idx)
+{
+  #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+    st.counter[idx] += st.steps[idx];
+  #else
+    st.counter[idx] += st.exec_block->steps[idx];
+  #endif
+  if (st.counter[idx] > st.exec_block->step_event_count) {
+    st.step_outbits |= (1<<st_step_bit[idx]);
+    #ifdef ENABLE_DUAL_AXIS
+      if (idx == DUAL_AXIS_SELECT) { st.step_outbits_dual = (1<<DUAL_STEP_BIT); }
+    #endif
+    st.counter[idx] -= st.exec_block->step_event_count;
+    if (st.exec_block->direction_bits & (1<<st_direction_bit[idx])) { sys_position[idx]--; }
+    else { sys_position[idx]++; }
+  }
+}
+
+
 /* “步进驱动程序中断”-此定时器中断是Grbl的主要工作。
    Grbl采用久负盛名的Bresenham直线算法来管理和精确同步多轴移动。
    与流行的DDA算法不同，Bresenham算法不受数值舍入误差的影响，只需要快速整数计数器，这意味着计算开销较低，并最大限度地提高了Arduino的性能。
@@ -283,6 +450,10 @@ void st_go_idle()
 ISR(TIMER1_COMPA_vect)
 {
   if (busy) { return; } //忙标志用于避免重新进入该中断
+  #ifdef ISR_PROFILE
+    uint16_t profile_time = st_profile_timestamp();
+    uint16_t profile_mark = profile_time;
+  #endif
 
   //在我们步进步进器之前，将方向引脚设置几纳秒
   DIRECTION_PORT = (DIRECTION_PORT & ~DIRECTION_MASK) | (st.dir_outbits & DIRECTION_MASK);
@@ -311,6 +482,15 @@ ISR(TIMER1_COMPA_vect)
   sei(); //重新启用中断，以允许步进器端口重置中断按时触发。
 //注意：此ISR中的剩余代码将在返回主程序之前完成。
 
+  #ifdef ISR_PROFILE
+    //第一个读数本身就是从比较匹配到进入中断的延迟，计入脉冲输出部分。
+    profile_time = st_profile_timestamp();
+    st_profile_record(ISR_PROFILE_STEP_PULSE, st_profile_cycles(0, profile_time));
+    //开中断之后被串口接收中断占用的时间不计入步进中断。在这之前中断是关闭的，不会嵌套。
+    uint16_t profile_nested = st_profile_nested();
+    uint16_t profile_nested_start = profile_nested;
+  #endif
+
   //如果没有步进段，尝试从步进缓冲区弹出一个
   if (st.exec_segment == NULL) {
     //缓冲区里有东西吗？如果是，加载并初始化下一步段。
@@ -326,6 +506,14 @@ ISR(TIMER1_COMPA_vect)
       //初始化每个步骤的步骤段计时，并加载要执行的步骤数。
       OCR1A = st.exec_segment->cycles_per_tick;
       st.step_count = st.exec_segment->n_step; //注意：缓慢移动时，有时可能为零。
+      #ifdef ST_SEGMENT_HOOK
+        //主机仿真在跟踪中记录段和块的边界。
+        #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+          ST_SEGMENT_HOOK(st.exec_block_index != st.exec_segment->st_block_index, st.exec_segment->n_step, st.exec_segment->AMASS_level);
+        #else
+          ST_SEGMENT_HOOK(st.exec_block_index != st.exec_segment->st_block_index, st.exec_segment->n_step, 0);
+        #endif
+      #endif
 //如果新段启动了新的规划器块，则初始化步进器变量和计数器。
 //注意：当段数据索引更改时，这表示一个新的规划器块。
       if ( st.exec_block_index != st.exec_segment->st_block_index ) {
@@ -333,7 +521,8 @@ ISR(TIMER1_COMPA_vect)
         st.exec_block = &st_block_buffer[st.exec_block_index];
 
         //初始化Bresenham测线和距离计数器
-        st.counter_x = st.counter_y = st.counter_z = (st.exec_block->step_event_count >> 1);
+        #define ST_COUNTER_INIT(idx) st.counter[idx] = (st.exec_block->step_event_count >> 1)
+        ST_FOR_EACH_AXIS(ST_COUNTER_INIT);
       }
       st.dir_outbits = st.exec_block->direction_bits ^ dir_port_invert_mask;
       #ifdef ENABLE_DUAL_AXIS
@@ -342,9 +531,8 @@ ISR(TIMER1_COMPA_vect)
 
       #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
         //启用AMASS后，根据AMASS级别调整Bresenham轴增量计数器。
-        st.steps[X_AXIS] = st.exec_block->steps[X_AXIS] >> st.exec_segment->AMASS_level;
-        st.steps[Y_AXIS] = st.exec_block->steps[Y_AXIS] >> st.exec_segment->AMASS_level;
-        st.steps[Z_AXIS] = st.exec_block->steps[Z_AXIS] >> st.exec_segment->AMASS_level;
+        #define ST_AMASS_STEPS(idx) st.steps[idx] = st.exec_block->steps[idx] >> st.exec_segment->AMASS_level
+        ST_FOR_EACH_AXIS(ST_AMASS_STEPS);
       #endif
 
       #ifdef VARIABLE_SPINDLE
@@ -354,6 +542,12 @@ ISR(TIMER1_COMPA_vect)
 
     } else {
       //段缓冲区为空。关闭。
+      #ifdef REPORT_SEGMENT_UNDERRUNS
+        //运动还没有结束：段准备还有块没有准备完。这是欠载。中断中只读段准备发布的标志，不访问规划器。
+        if (bit_isfalse(sys.step_control,STEP_CONTROL_END_MOTION) && prep_block_pending) {
+          if (segment_underrun_count != 0xFFFF) { segment_underrun_count++; }
+        }
+      #endif
       st_go_idle();
       #ifdef VARIABLE_SPINDLE
         //完成速率控制运动后，确保pwm设置正确。
@@ -362,6 +556,13 @@ ISR(TIMER1_COMPA_vect)
       system_set_exec_state_flag(EXEC_CYCLE_STOP); //为循环结束标记主程序
       return; //除了退出别无选择。
     }
+    #ifdef ISR_PROFILE
+      uint16_t profile_load = st_profile_timestamp();
+      uint16_t profile_nested_load = st_profile_nested();
+      st_profile_record(ISR_PROFILE_STEP_LOAD, st_profile_own_cycles(st_profile_cycles(profile_time, profile_load), profile_nested_load-profile_nested));
+      profile_time = profile_load;
+      profile_nested = profile_nested_load;
+    #endif
   }
 
 
@@ -375,45 +576,7 @@ ISR(TIMER1_COMPA_vect)
   #endif
 
   //用Bresenham线算法执行步进位移剖面
-  #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
-    st.counter_x += st.steps[X_AXIS];
-  #else
-    st.counter_x += st.exec_block->steps[X_AXIS];
-  #endif
-  if (st.counter_x > st.exec_block->step_event_count) {
-    st.step_outbits |= (1<<X_STEP_BIT);
-    #if defined(ENABLE_DUAL_AXIS) && (DUAL_AXIS_SELECT == X_AXIS)
-      st.step_outbits_dual = (1<<DUAL_STEP_BIT);
-    #endif
-    st.counter_x -= st.exec_block->step_event_count;
-    if (st.exec_block->direction_bits & (1<<X_DIRECTION_BIT)) { sys_position[X_AXIS]--; }
-    else { sys_position[X_AXIS]++; }
-  }
-  #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
-    st.counter_y += st.steps[Y_AXIS];
-  #else
-    st.counter_y += st.exec_block->steps[Y_AXIS];
-  #endif
-  if (st.counter_y > st.exec_block->step_event_count) {
-    st.step_outbits |= (1<<Y_STEP_BIT);
-    #if defined(ENABLE_DUAL_AXIS) && (DUAL_AXIS_SELECT == Y_AXIS)
-      st.step_outbits_dual = (1<<DUAL_STEP_BIT);
-    #endif
-    st.counter_y -= st.exec_block->step_event_count;
-    if (st.exec_block->direction_bits & (1<<Y_DIRECTION_BIT)) { sys_position[Y_AXIS]--; }
-    else { sys_position[Y_AXIS]++; }
-  }
-  #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
-    st.counter_z += st.steps[Z_AXIS];
-  #else
-    st.counter_z += st.exec_block->steps[Z_AXIS];
-  #endif
-  if (st.counter_z > st.exec_block->step_event_count) {
-    st.step_outbits |= (1<<Z_STEP_BIT);
-    st.counter_z -= st.exec_block->step_event_count;
-    if (st.exec_block->direction_bits & (1<<Z_DIRECTION_BIT)) { sys_position[Z_AXIS]--; }
-    else { sys_position[Z_AXIS]++; }
-  }
+  ST_FOR_EACH_AXIS(st_bresenham_axis);
 
   //在归位循环期间，锁定并防止所需轴移动。
   if (sys.state == STATE_HOMING) { 
@@ -434,6 +597,18 @@ ISR(TIMER1_COMPA_vect)
   #ifdef ENABLE_DUAL_AXIS
     st.step_outbits_dual ^= step_port_invert_mask_dual;
   #endif
+
+  #ifdef ISR_PROFILE
+    uint16_t profile_end = st_profile_timestamp();
+    uint16_t profile_nested_end = st_profile_nested();
+    st_profile_record(ISR_PROFILE_STEP_BRESENHAM, st_profile_own_cycles(st_profile_cycles(profile_time, profile_end), profile_nested_end-profile_nested));
+    uint16_t profile_total = st_profile_own_cycles(st_profile_cycles(0, profile_end), profile_nested_end-profile_nested_start);
+    if (profile_end < profile_mark) { profile_total = 0xFFFF; } //中断超过了一个步进周期
+    st_profile_record(ISR_PROFILE_STEP_TOTAL, profile_total);
+    uint8_t bin = profile_total >> ISR_PROFILE_HISTOGRAM_SHIFT;
+    if (bin >= ISR_PROFILE_HISTOGRAM_SIZE) { bin = ISR_PROFILE_HISTOGRAM_SIZE-1; }
+    if (isr_profile_histogram[bin] != 0xFFFF) { isr_profile_histogram[bin]++; }
+  #endif
   busy = false;
 }
 
@@ -487,6 +662,15 @@ void st_generate_step_dir_invert_masks()
 }
 
 
+#ifdef AMASS_RUNTIME_CUTOFFS
+//由$38生成AMASS第1级截止频率的每步周期数。
+void st_generate_amass_cutoff()
+{
+  amass_cutoff_cycles = F_CPU/settings.amass_cutoff;
+}
+#endif
+
+
 //重置并清除步进机子系统变量
 void st_reset()
 {
@@ -502,8 +686,15 @@ void st_reset()
   segment_buffer_head = 0; // empty = tail
   segment_next_head = 1;
   busy = false;
+  #ifdef REPORT_SEGMENT_UNDERRUNS
+    segment_underrun_count = 0;
+    prep_block_pending = false;
+  #endif
 
   st_generate_step_dir_invert_masks();
+  #ifdef AMASS_RUNTIME_CUTOFFS
+    st_generate_amass_cutoff();
+  #endif
   st.dir_outbits = dir_port_invert_mask; //将方向位初始化为默认值。
 
   //初始化步进和方向端口引脚。
@@ -547,9 +738,29 @@ void stepper_init()
   #ifdef STEP_PULSE_DELAY
     TIMSK0 |= (1<<OCIE0A); //启用定时器0比较匹配中断
   #endif
+
+  #ifdef ISR_PROFILE
+    st_profile_reset();
+  #endif
 }
 
 
+#ifdef ISR_PROFILE
+  //清除中断执行时间统计。最短时间置为最大值，以便第一次记录时更新。
+  void st_profile_reset()
+  {
+    uint8_t sreg = SREG;
+    cli();
+    memset(isr_profile, 0, sizeof(isr_profile));
+    memset(isr_profile_histogram, 0, sizeof(isr_profile_histogram));
+    uint8_t idx;
+    for (idx=0; idx<ISR_PROFILE_N; idx++) { isr_profile[idx].min = 0xFFFF; }
+    isr_profile_nested = 0;
+    SREG = sreg;
+  }
+#endif
+
+
 //当执行块由新计划更新时，由planner_recalculate（）调用。
 void st_update_plan_block_parameters()
 {
@@ -562,7 +773,7 @@ void st_update_plan_block_parameters()
 
 
 //递增步段缓冲块数据环缓冲区。
-static uint8_t st_next_block_index(uint8_t block_index)
+static segment_index_t st_next_block_index(segment_index_t block_index)
 {
   block_index++;
   if ( block_index == (SEGMENT_BUFFER_SIZE-1) ) { return(0); }
@@ -580,6 +791,14 @@ static uint8_t st_next_block_index(uint8_t block_index)
       prep.last_steps_remaining = prep.steps_remaining;
       prep.last_dt_remainder = prep.dt_remainder;
       prep.last_step_per_mm = prep.step_per_mm;
+      #ifdef ST_PREP_FIXED_POINT
+        prep.last_fx_remaining = prep.fx_remaining;
+      #endif
+      #ifdef NATIVE_ARC_BLOCKS
+        //圆弧已经执行的弦，恢复后从这里继续，而不是从圆弧起点重走。
+        memcpy(prep.last_arc_steps, prep.arc_steps, sizeof(prep.arc_steps));
+        prep.last_arc_block_used = prep.arc_block_used;
+      #endif
     }
     //设置标志以执行停车运动
     prep.recalculate_flag |= PREP_FLAG_PARKING;
@@ -598,6 +817,13 @@ static uint8_t st_next_block_index(uint8_t block_index)
       prep.steps_remaining = prep.last_steps_remaining;
       prep.dt_remainder = prep.last_dt_remainder;
       prep.step_per_mm = prep.last_step_per_mm;
+      #ifdef ST_PREP_FIXED_POINT
+        prep.fx_remaining = prep.last_fx_remaining;
+      #endif
+      #ifdef NATIVE_ARC_BLOCKS
+        memcpy(prep.arc_steps, prep.last_arc_steps, sizeof(prep.arc_steps));
+        prep.arc_block_used = prep.last_arc_block_used;
+      #endif
       prep.recalculate_flag = (PREP_FLAG_HOLD_PARTIAL_BLOCK | PREP_FLAG_RECALCULATE);
       prep.req_mm_increment = REQ_MM_INCREMENT_SCALAR/prep.step_per_mm; //重新计算此值。
     } else {
@@ -608,6 +834,246 @@ static uint8_t st_next_block_index(uint8_t block_index)
 #endif
 
 
+#ifdef S_CURVE_PROFILE
+  //正在进行的S形斜坡的当前加速度。斜坡结束后为零。
+  static float st_scurve_acceleration()
+  {
+    if (prep.ramp_time >= prep.ramp_duration) { return(0.0); }
+    float x = prep.ramp_time/prep.ramp_duration;
+    return(6.0*prep.ramp_delta*x*(1.0-x)/prep.ramp_duration + prep.ramp_accel*(1.0-x)*(1.0-3.0*x));
+  }
+
+
+  //从当前速度和当前加速度开始一个S形斜坡，在距块末端mm_end处到达target_speed，加速度为零。
+  //速度是三次Hermite曲线：v = v0 + dv*(3x^2-2x^3) + a0*T*x(1-x)^2，x为斜坡中的时间比例。
+  //斜坡时间T由距离决定：T*(v0+v1)/2 + a0*T^2/12 = 距离，所以速度在规划器给定的位置准确到达目标，
+  //a0为零时与加速度为规划器加速度的梯形斜坡的时间和距离相同，峰值加速度是它的1.5倍。
+  //新块从零加速度开始；重新计算剖面时继承正在进行的斜坡的加速度，加速度保持连续。
+  //继承加速度使峰值超过1.5倍时（例如加速中进给保持，要在规划器给定的距离内停下）改为从零开始。
+  static void st_scurve_start(float target_speed, float acceleration, float mm_start, float mm_end)
+  {
+    float a0 = st_scurve_acceleration();
+    float dv = target_speed-prep.current_speed;
+    float mm = mm_start-mm_end;
+    if (mm < 0.0) { mm = 0.0; }
+    float b = 0.5*(prep.current_speed+target_speed);
+    if (b <= 0.0) { a0 = 0.0; b = 1.0; mm = 0.0; } //起点和终点速度都为零，没有斜坡
+    float duration = mm/b;
+    if (a0 != 0.0) {
+      float disc = b*b + (a0/3.0)*mm;
+      if (disc < 0.0) { a0 = 0.0; }
+      else {
+        duration = 2.0*mm/(b+sqrt(disc)); //二次方程的正根
+        //加速度a(x) = k2*x^2 + k1*x + a0，峰值在x=0、x=1（为零）或顶点处。
+        float k = 6.0*dv/duration;
+        float k2 = 3.0*a0-k;
+        float k1 = k-4.0*a0;
+        float peak = fabs(a0);
+        if (k2 != 0.0) {
+          float x = -0.5*k1/k2;
+          if ((x > 0.0) && (x < 1.0)) { peak = max(peak, fabs((k2*x+k1)*x+a0)); }
+        }
+        if (peak > 1.5*acceleration) { a0 = 0.0; }
+      }
+      if (a0 == 0.0) { duration = mm/b; }
+    }
+    prep.ramp_time = 0.0;
+    prep.ramp_speed = prep.current_speed;
+    prep.ramp_delta = dv;
+    prep.ramp_accel = a0;
+    prep.ramp_duration = duration;
+    prep.ramp_mm = mm_start;
+    prep.ramp_end_mm = mm_end;
+  }
+
+
+  //把S形斜坡推进time_var，更新当前速度和剩余距离。
+  //如果斜坡在这段时间内结束，返回false，并把time_var改为到斜坡终点的时间，由调用者设置终点的状态。
+  static uint8_t st_scurve_advance(float *time_var, float *mm_remaining)
+  {
+    float t = prep.ramp_time + *time_var;
+    if (t < prep.ramp_duration) {
+      float x = t/prep.ramp_duration;
+      float x2 = x*x;
+      float a0_t = prep.ramp_accel*prep.ramp_duration;
+      //距离是速度的积分：t*(v0 + dv*x^2*(1-x/2)) + a0*T^2*x^2*(1/2-2x/3+x^2/4)
+      float mm = prep.ramp_mm - t*(prep.ramp_speed + prep.ramp_delta*x2*(1.0-0.5*x)) - a0_t*prep.ramp_duration*x2*(0.5-x*(2.0/3.0)+0.25*x2);
+      if (mm > prep.ramp_end_mm) { //舍入误差可能使距离先于时间到达终点，此时按斜坡结束处理。
+        prep.ramp_time = t;
+        prep.current_speed = prep.ramp_speed + prep.ramp_delta*x2*(3.0-2.0*x) + a0_t*x*(1.0-x)*(1.0-x);
+        *mm_remaining = mm;
+        return(true);
+      }
+    }
+    *time_var = prep.ramp_duration-prep.ramp_time;
+    prep.ramp_time = prep.ramp_duration;
+    return(false);
+  }
+#endif
+
+
+#ifdef ST_PREP_FIXED_POINT
+  //浮点数换算为定点数，四舍五入，负数为零。
+  static uint32_t st_fx_from_float(float value)
+  {
+    if (value <= 0.0) { return(0); }
+    return((uint32_t)(value+0.5));
+  }
+
+
+  //速度在time_var内的变化量。整段时间就是每段的加速度，不需要乘法。
+  //自适应段时间和慢速段的time_var可以是多个段，加速度大、每毫米步数多时32位乘积会溢出，所以用64位。
+  static uint32_t st_fx_speed_change(uint32_t time_var)
+  {
+    if (time_var == ST_FX_SEGMENT) { return(prep.fx_acceleration); }
+    return(((uint64_t)prep.fx_acceleration*time_var) >> ST_FX_TIME_SHIFT);
+  }
+
+
+  //以平均速度speed行驶time_var的距离。速度单位比距离细ST_FX_SPEED_SHIFT-ST_FX_DIST_SHIFT位，舍去的小数部分经carry
+  //带到下一段，否则匀速和匀加减速时每段的舍入误差都一样，会累积成系统偏差。
+  //自适应段时间和慢速段的time_var可以是多个段，乘积用64位，以免溢出。
+  static uint32_t st_fx_distance(uint32_t speed, uint32_t time_var, uint8_t *carry)
+  {
+    uint32_t distance = *carry; //速度单位的距离
+    if (time_var == ST_FX_SEGMENT) { distance += speed; } //整段时间是最常见的情况，不需要乘法。
+    else { distance += ((uint64_t)speed*time_var) >> ST_FX_TIME_SHIFT; }
+    *carry = distance & ((1UL<<(ST_FX_SPEED_SHIFT-ST_FX_DIST_SHIFT))-1);
+    return(distance >> (ST_FX_SPEED_SHIFT-ST_FX_DIST_SHIFT));
+  }
+
+
+  //以平均速度speed_sum/2行驶distance所需的时间，即浮点版本中的2*d/(v0+v1)。只在斜坡结点调用。
+  //速度不能先右移：减速到零附近时速度只剩几位有效数字，最后一段的时间会严重偏长。
+  //结点时间的分辨率只有1/256段，长度相同的短块每块的舍入误差都一样，所以多算ST_FX_TIME_CARRY_BITS位，
+  //舍去的部分带到下一个结点，总时间不会累积偏差。
+  #define ST_FX_RAMP_TIME_SHIFT (ST_FX_SPEED_SHIFT-ST_FX_DIST_SHIFT+ST_FX_TIME_SHIFT+1)
+  #define ST_FX_TIME_CARRY_BITS 4
+  static uint32_t st_fx_ramp_time(uint32_t distance, uint32_t speed_sum)
+  {
+    if (speed_sum == 0) { return(ST_FX_SEGMENT); } //零速度，距离只有一步的一小部分。
+    uint32_t time_var;
+    if (distance < (1UL<<(31-ST_FX_RAMP_TIME_SHIFT))) {
+      uint32_t numerator = distance << ST_FX_RAMP_TIME_SHIFT;
+      time_var = numerator/speed_sum;
+      if (time_var >= (1UL<<(31-ST_FX_TIME_CARRY_BITS))) { return(time_var); } //极慢，小数部分无关紧要。
+      //余数小于速度，左移不会溢出。
+      time_var = (time_var << ST_FX_TIME_CARRY_BITS) + (((numerator % speed_sum) << ST_FX_TIME_CARRY_BITS)/speed_sum);
+    } else {
+      time_var = (((uint64_t)distance) << (ST_FX_RAMP_TIME_SHIFT+ST_FX_TIME_CARRY_BITS))/speed_sum; //长斜坡，左移会溢出
+    }
+    time_var += prep.fx_time_carry;
+    prep.fx_time_carry = time_var & ((1<<ST_FX_TIME_CARRY_BITS)-1);
+    return(time_var >> ST_FX_TIME_CARRY_BITS);
+  }
+#endif
+
+
+//设置正在准备的步进块数据的方向位。
+static void st_prep_block_direction(uint8_t direction_bits)
+{
+  st_prep_block->direction_bits = direction_bits;
+  #ifdef ENABLE_DUAL_AXIS
+    #if (DUAL_AXIS_SELECT == X_AXIS)
+      if (direction_bits & (1<<X_DIRECTION_BIT)) { 
+    #elif (DUAL_AXIS_SELECT == Y_AXIS)
+      if (direction_bits & (1<<Y_DIRECTION_BIT)) { 
+    #endif
+      st_prep_block->direction_bits_dual = (1<<DUAL_DIRECTION_BIT); 
+    }  else { st_prep_block->direction_bits_dual = 0; }
+  #endif
+}
+
+
+#ifdef NATIVE_ARC_BLOCKS
+  //圆弧块：准备从上一条弦的终点到剩余steps_remaining个虚拟步处圆弧上的点的弦，写入段的步进块数据。
+  //返回弦的步事件数。弦上没有步时返回0，不占用步进块数据。
+  static uint16_t st_prep_arc_chord(segment_t *prep_segment, float steps_remaining)
+  {
+    int32_t arc_steps[N_AXIS];
+    uint8_t idx;
+    if (steps_remaining == 0.0) {
+      //终点使用规划器的步数，保证精确到达规划器位置。
+      for (idx=0; idx<N_AXIS; idx++) {
+        arc_steps[idx] = pl_block->steps[idx];
+        if (pl_block->direction_bits & get_direction_pin_mask(idx)) { arc_steps[idx] = -arc_steps[idx]; }
+      }
+    } else {
+      plan_arc_t *arc = &pl_block->arc;
+      float fraction = 1.0 - steps_remaining/pl_block->step_event_count;
+      float angle = arc->angular_travel*fraction;
+      float cos_Ti = cos(angle) - 1.0;
+      float sin_Ti = sin(angle);
+      float offset[N_AXIS];
+      offset[arc->axis_0] = arc->r_axis0*cos_Ti - arc->r_axis1*sin_Ti;
+      offset[arc->axis_1] = arc->r_axis0*sin_Ti + arc->r_axis1*cos_Ti;
+      offset[arc->axis_linear] = arc->linear_travel*fraction;
+      for (idx=0; idx<N_AXIS; idx++) { arc_steps[idx] = lround(offset[idx]*settings.steps_per_mm[idx]); }
+    }
+
+    uint32_t steps[N_AXIS];
+    uint32_t step_event_count = 0;
+    uint8_t direction_bits = 0;
+    for (idx=0; idx<N_AXIS; idx++) {
+      int32_t delta = arc_steps[idx] - prep.arc_steps[idx];
+      if (delta < 0) { direction_bits |= get_direction_pin_mask(idx); }
+      steps[idx] = labs(delta);
+      step_event_count = max(step_event_count, steps[idx]);
+    }
+    if (step_event_count == 0) { return(0); }
+    memcpy(prep.arc_steps, arc_steps, sizeof(arc_steps));
+
+    //每条弦使用自己的步进块数据，步进ISR在段之间会重新开始Bresenham计数。
+    if (prep.arc_block_used) {
+      #ifdef VARIABLE_SPINDLE
+        uint8_t is_pwm_rate_adjusted = st_prep_block->is_pwm_rate_adjusted;
+      #endif
+      prep.st_block_index = st_next_block_index(prep.st_block_index);
+      st_prep_block = &st_block_buffer[prep.st_block_index];
+      #ifdef VARIABLE_SPINDLE
+        st_prep_block->is_pwm_rate_adjusted = is_pwm_rate_adjusted;
+      #endif
+    }
+    prep.arc_block_used = true;
+    prep_segment->st_block_index = prep.st_block_index;
+    st_prep_block_direction(direction_bits);
+    #ifndef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+      for (idx=0; idx<N_AXIS; idx++) { st_prep_block->steps[idx] = (steps[idx] << 1); }
+      st_prep_block->step_event_count = (step_event_count << 1);
+    #else
+      for (idx=0; idx<N_AXIS; idx++) { st_prep_block->steps[idx] = steps[idx] << MAX_AMASS_LEVEL; }
+      st_prep_block->step_event_count = step_event_count << MAX_AMASS_LEVEL;
+    #endif
+    return(step_event_count);
+  }
+#endif
+
+
+#ifdef ADAPTIVE_SEGMENT_TIME
+  //根据当前步进速率和段缓冲区中的段数选择下一段的时间。返回段时间相对DT_SEGMENT的倍数的以2为底的对数（-1到2）。
+  static int8_t st_segment_time_shift()
+  {
+    #ifdef ST_PREP_FIXED_POINT
+      uint32_t steps = prep.fx_current_speed >> ST_FX_SPEED_SHIFT; //每个DT_SEGMENT的步数
+    #else
+      float steps = prep.current_speed*prep.step_per_mm*DT_SEGMENT;
+    #endif
+    if (steps < ADAPTIVE_SEGMENT_MIN_STEPS) {
+      if (2*steps < ADAPTIVE_SEGMENT_MIN_STEPS) { return(2); }
+      return(1);
+    }
+    //巡航时速度不变，缩短段没有意义。段缓冲区不到半满时不缩短，以免缓冲的时间太少。
+    if ((steps > ADAPTIVE_SEGMENT_MAX_STEPS) && (prep.ramp_type != RAMP_CRUISE)) {
+      segment_index_t tail = st_segment_buffer_tail();
+      segment_index_t queued = segment_buffer_head - tail;
+      if (segment_buffer_head < tail) { queued += SEGMENT_BUFFER_SIZE; }
+      if (queued >= (SEGMENT_BUFFER_SIZE/2)) { return(-1); }
+    }
+    return(0);
+  }
+#endif
+
+
 /*准备步进段缓冲区。从主程序连续调用。
 
 分段缓冲区是步进算法执行步骤与规划器生成的速度剖面之间的中间缓冲界面。
@@ -622,7 +1088,7 @@ void st_prep_buffer()
   //当处于挂起状态且没有要执行的挂起运动时，阻止步骤准备缓冲区。
   if (bit_istrue(sys.step_control,STEP_CONTROL_END_MOTION)) { return; }
 
-  while (segment_buffer_tail != segment_next_head) { //检查是否需要填充缓冲区。
+  while (st_segment_buffer_tail() != segment_next_head) { //检查是否需要填充缓冲区。
 
     //确定是否需要加载新的规划器块或是否需要重新计算该块。
     if (pl_block == NULL) {
@@ -630,6 +1096,9 @@ void st_prep_buffer()
       //排队块的查询计划器
       if (sys.step_control & STEP_CONTROL_EXECUTE_SYS_MOTION) { pl_block = plan_get_system_motion_block(); }
       else { pl_block = plan_get_current_block(); }
+      #ifdef REPORT_SEGMENT_UNDERRUNS
+        prep_block_pending = (pl_block != NULL);
+      #endif
       if (pl_block == NULL) { return; } //没有规划块。退出
 
       //检查是否只需要重新计算速度剖面或加载新块。
@@ -649,15 +1118,13 @@ void st_prep_buffer()
 
         //准备并复制新规划器块中的Bresenham算法段数据，以便当段缓冲区完成规划器块时，当段缓冲区完成预处理的块时，该数据可能会被丢弃，但步进程序ISR仍在执行该数据。
         st_prep_block = &st_block_buffer[prep.st_block_index];
-        st_prep_block->direction_bits = pl_block->direction_bits;
-        #ifdef ENABLE_DUAL_AXIS
-          #if (DUAL_AXIS_SELECT == X_AXIS)
-            if (st_prep_block->direction_bits & (1<<X_DIRECTION_BIT)) { 
-          #elif (DUAL_AXIS_SELECT == Y_AXIS)
-            if (st_prep_block->direction_bits & (1<<Y_DIRECTION_BIT)) { 
-          #endif
-            st_prep_block->direction_bits_dual = (1<<DUAL_DIRECTION_BIT); 
-          }  else { st_prep_block->direction_bits_dual = 0; }
+        st_prep_block_direction(pl_block->direction_bits);
+        #ifdef NATIVE_ARC_BLOCKS
+          prep.arc_block_used = false;
+          memset(prep.arc_steps, 0, sizeof(prep.arc_steps));
+        #endif
+        #ifdef S_CURVE_PROFILE
+          prep.ramp_time = prep.ramp_duration = 0.0; //新块的斜坡从零加速度开始
         #endif
         uint8_t idx;
         #ifndef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
@@ -671,10 +1138,16 @@ void st_prep_buffer()
         #endif
 
         //初始化用于生成段的段缓冲区数据。
-        prep.steps_remaining = (float)pl_block->step_event_count;
-        prep.step_per_mm = prep.steps_remaining/pl_block->millimeters;
+        #ifdef ST_PREP_FIXED_POINT
+          prep.steps_remaining = pl_block->step_event_count << ST_FX_DIST_SHIFT;
+          prep.fx_remaining = prep.steps_remaining;
+          prep.dt_remainder = 0; //重置新的段块
+        #else
+          prep.steps_remaining = (float)pl_block->step_event_count;
+          prep.dt_remainder = 0.0; //重置新的段块
+        #endif
+        prep.step_per_mm = (float)pl_block->step_event_count/pl_block->millimeters;
         prep.req_mm_increment = REQ_MM_INCREMENT_SCALAR/prep.step_per_mm;
-        prep.dt_remainder = 0.0; //重置新的段块
 
         if ((sys.step_control & STEP_CONTROL_EXECUTE_HOLD) || (prep.recalculate_flag & PREP_FLAG_DECEL_OVERRIDE)) {
           //新块加载中间保持。覆盖规划器块进入速度以强制减速。
@@ -785,6 +1258,29 @@ void st_prep_buffer()
 				}
 			}
       
+      #ifdef ST_PREP_FIXED_POINT
+        //把速度剖面换算为定点数。边界不能超过当前的精确剩余距离，否则段准备中的减法会溢出。
+        float fx_dist_scale = prep.step_per_mm*(1UL<<ST_FX_DIST_SHIFT);
+        float fx_speed_scale = prep.step_per_mm*(DT_SEGMENT*(1UL<<ST_FX_SPEED_SHIFT));
+        prep.mm_per_fx = 1.0/fx_dist_scale;
+        prep.fx_inv_speed_scale = 1.0/fx_speed_scale;
+        prep.fx_complete = min(st_fx_from_float(prep.mm_complete*fx_dist_scale), prep.fx_remaining);
+        prep.fx_accelerate_until = min(st_fx_from_float(prep.accelerate_until*fx_dist_scale), prep.fx_remaining);
+        prep.fx_decelerate_after = min(st_fx_from_float(prep.decelerate_after*fx_dist_scale), prep.fx_remaining);
+        prep.fx_current_speed = st_fx_from_float(prep.current_speed*fx_speed_scale);
+        prep.fx_maximum_speed = st_fx_from_float(prep.maximum_speed*fx_speed_scale);
+        prep.fx_exit_speed = st_fx_from_float(prep.exit_speed*fx_speed_scale);
+        prep.fx_acceleration = st_fx_from_float(pl_block->acceleration*fx_speed_scale*DT_SEGMENT);
+        prep.fx_distance_carry = 0;
+      #endif
+
+      #ifdef S_CURVE_PROFILE
+        //剖面从斜坡开始时，在这里开始第一个S形斜坡。重新计算剖面时从正在进行的斜坡的加速度继续。
+        if (prep.ramp_type == RAMP_ACCEL) { st_scurve_start(prep.maximum_speed, pl_block->acceleration, pl_block->millimeters, prep.accelerate_until); }
+        else if (prep.ramp_type == RAMP_DECEL) { st_scurve_start(prep.exit_speed, pl_block->acceleration, pl_block->millimeters, prep.mm_complete); }
+        else { prep.ramp_time = prep.ramp_duration; } //巡航或减速覆盖，S形斜坡结束
+      #endif
+
       #ifdef VARIABLE_SPINDLE
         bit_true(sys.step_control, STEP_CONTROL_UPDATE_SPINDLE_PWM); //每当更新块时强制更新。
       #endif
@@ -805,7 +1301,113 @@ void st_prep_buffer()
       加速斜坡、巡航状态和减速斜坡。
       每个斜坡的行驶距离可能从零到块的长度。
       速度曲线可以在计划块（典型）的末端结束，也可以在强制减速的末端（例如从进给保持）的中间块结束。 */
+    #ifdef ST_PREP_FIXED_POINT
+      //与下面的浮点版本相同，只是距离、时间和速度都是定点数。整段时间内的斜坡积分只有整数乘法和加减法，
+      //除法只在斜坡结点出现。块的速度剖面仍然用浮点数计算，每个块只计算一次。
+      uint32_t dt_max = ST_FX_SEGMENT; //最大分段时间
+      #ifdef ADAPTIVE_SEGMENT_TIME
+        int8_t dt_shift = st_segment_time_shift();
+        if (dt_shift < 0) { dt_max >>= 1; }
+        else { dt_max <<= dt_shift; }
+      #endif
+      uint32_t dt = 0; //初始化段时间
+      uint32_t time_var = dt_max; //时间工作者变量
+      uint32_t fx_var; //距离工作变量
+      uint32_t speed_var; //速度工作者变量
+      uint8_t carry_var; //距离小数工作变量
+      uint32_t fx_remaining = prep.fx_remaining; //新线段到块末端的距离。
+      uint32_t minimum_fx = 0; //保证至少一步。
+      if (fx_remaining > ST_FX_REQ_INCREMENT) { minimum_fx = fx_remaining-ST_FX_REQ_INCREMENT; }
+
+      do {
+        switch (prep.ramp_type) {
+          case RAMP_DECEL_OVERRIDE:
+            speed_var = st_fx_speed_change(time_var);
+            if (prep.fx_current_speed-prep.fx_maximum_speed <= speed_var) {
+              //巡航或巡航减速类型仅适用于减速覆盖。
+              time_var = st_fx_ramp_time(fx_remaining-prep.fx_accelerate_until, prep.fx_current_speed+prep.fx_maximum_speed);
+              fx_remaining = prep.fx_accelerate_until;
+              prep.ramp_type = RAMP_CRUISE;
+              prep.fx_current_speed = prep.fx_maximum_speed;
+              prep.fx_distance_carry = 0;
+            } else { //中间斜坡减速覆盖。
+              fx_remaining -= st_fx_distance(prep.fx_current_speed-(speed_var >> 1), time_var, &prep.fx_distance_carry);
+              prep.fx_current_speed -= speed_var;
+            }
+            break;
+          case RAMP_ACCEL:
+            //注意：加速斜坡仅在第一个do while循环期间计算。
+            speed_var = st_fx_speed_change(time_var);
+            carry_var = prep.fx_distance_carry;
+            fx_var = st_fx_distance(prep.fx_current_speed+(speed_var >> 1), time_var, &carry_var);
+            if (fx_var >= fx_remaining-prep.fx_accelerate_until) { //加速坡道的终点。
+              time_var = st_fx_ramp_time(fx_remaining-prep.fx_accelerate_until, prep.fx_current_speed+prep.fx_maximum_speed);
+              fx_remaining = prep.fx_accelerate_until;
+              if (fx_remaining == prep.fx_decelerate_after) { prep.ramp_type = RAMP_DECEL; }
+              else { prep.ramp_type = RAMP_CRUISE; }
+              prep.fx_current_speed = prep.fx_maximum_speed;
+              prep.fx_distance_carry = 0;
+            } else { //只有加速。
+              fx_remaining -= fx_var;
+              prep.fx_current_speed += speed_var;
+              prep.fx_distance_carry = carry_var;
+            }
+            break;
+          case RAMP_CRUISE:
+            carry_var = prep.fx_distance_carry;
+            fx_var = st_fx_distance(prep.fx_maximum_speed, time_var, &carry_var);
+            if (fx_var >= fx_remaining-prep.fx_decelerate_after) { //巡航结束。
+              time_var = st_fx_ramp_time(fx_remaining-prep.fx_decelerate_after, prep.fx_maximum_speed << 1);
+              fx_remaining = prep.fx_decelerate_after;
+              prep.ramp_type = RAMP_DECEL;
+              prep.fx_distance_carry = 0;
+            } else { //仅限巡航。
+              fx_remaining -= fx_var;
+              prep.fx_distance_carry = carry_var;
+            }
+            break;
+          default: //斜坡减速情况。
+            speed_var = st_fx_speed_change(time_var);
+            if (prep.fx_current_speed > speed_var) { //检查是否处于或低于零速。
+              carry_var = prep.fx_distance_carry;
+              fx_var = st_fx_distance(prep.fx_current_speed-(speed_var >> 1), time_var, &carry_var);
+              if (fx_var < fx_remaining-prep.fx_complete) { //典型案例。在减速坡道上。
+                fx_remaining -= fx_var;
+                prep.fx_current_speed -= speed_var;
+                prep.fx_distance_carry = carry_var;
+                break;
+              }
+            }
+            //否则，在挡块末端或强制减速末端。
+            time_var = st_fx_ramp_time(fx_remaining-prep.fx_complete, prep.fx_current_speed+prep.fx_exit_speed);
+            fx_remaining = prep.fx_complete;
+            prep.fx_current_speed = prep.fx_exit_speed;
+            prep.fx_distance_carry = 0;
+        }
+        dt += time_var; //将计算的爬坡时间添加到总分段时间。
+        if (dt < dt_max) { time_var = dt_max - dt; } // **未完成** 在斜坡结点。
+        else {
+          if (fx_remaining > minimum_fx) { //检查零步距的非常慢的段。
+            dt_max += ST_FX_SEGMENT;
+            time_var = dt_max - dt;
+          } else {
+            break; //**完成**退出循环。段执行时间已达到最大值。
+          }
+        }
+      } while (fx_remaining > prep.fx_complete); //**完成**退出循环。剖面完成。
+
+      //状态报告、重新规划和激光功率仍然使用浮点速度。
+      prep.current_speed = prep.fx_current_speed*prep.fx_inv_speed_scale;
+      float mm_remaining;
+      if (fx_remaining == prep.fx_complete) { mm_remaining = prep.mm_complete; }
+      else { mm_remaining = fx_remaining*prep.mm_per_fx; }
+    #else
     float dt_max = DT_SEGMENT; //最大分段时间
+    #ifdef ADAPTIVE_SEGMENT_TIME
+      int8_t dt_shift = st_segment_time_shift();
+      if (dt_shift < 0) { dt_max *= 0.5; }
+      else { dt_max *= (1 << dt_shift); }
+    #endif
     float dt = 0.0; //初始化段时间
     float time_var = dt_max; //时间工作者变量
     float mm_var; //毫米距离工作变量
@@ -831,17 +1433,27 @@ void st_prep_buffer()
           break;
         case RAMP_ACCEL:
           //注意：加速斜坡仅在第一个do while循环期间计算。
-          speed_var = pl_block->acceleration*time_var;
-          mm_remaining -= time_var*(prep.current_speed + 0.5*speed_var);
-          if (mm_remaining < prep.accelerate_until) { //加速坡道的终点。 加速巡航、加速减速斜坡结点或块终点。
-            mm_remaining = prep.accelerate_until; // NOTE: 0.0 at EOB
-            time_var = 2.0*(pl_block->millimeters-mm_remaining)/(prep.current_speed+prep.maximum_speed);
-            if (mm_remaining == prep.decelerate_after) { prep.ramp_type = RAMP_DECEL; }
-            else { prep.ramp_type = RAMP_CRUISE; }
+          #ifdef S_CURVE_PROFILE
+            if (st_scurve_advance(&time_var, &mm_remaining)) { break; } //只有加速。
+            mm_remaining = prep.accelerate_until; //加速坡道的终点。time_var已是到终点的时间。
             prep.current_speed = prep.maximum_speed;
-          } else { //只有加速。
-            prep.current_speed += speed_var;
-          }
+            if (mm_remaining == prep.decelerate_after) {
+              prep.ramp_type = RAMP_DECEL;
+              st_scurve_start(prep.exit_speed, pl_block->acceleration, mm_remaining, prep.mm_complete);
+            } else { prep.ramp_type = RAMP_CRUISE; }
+          #else
+            speed_var = pl_block->acceleration*time_var;
+            mm_remaining -= time_var*(prep.current_speed + 0.5*speed_var);
+            if (mm_remaining < prep.accelerate_until) { //加速坡道的终点。 加速巡航、加速减速斜坡结点或块终点。
+              mm_remaining = prep.accelerate_until; // NOTE: 0.0 at EOB
+              time_var = 2.0*(pl_block->millimeters-mm_remaining)/(prep.current_speed+prep.maximum_speed);
+              if (mm_remaining == prep.decelerate_after) { prep.ramp_type = RAMP_DECEL; }
+              else { prep.ramp_type = RAMP_CRUISE; }
+              prep.current_speed = prep.maximum_speed;
+            } else { //只有加速。
+              prep.current_speed += speed_var;
+            }
+          #endif
           break;
         case RAMP_CRUISE:
           //注：mm_var用于保留最后剩余的mm_remaining，用于不完整的分段time_ var计算。
@@ -851,24 +1463,34 @@ void st_prep_buffer()
             time_var = (mm_remaining - prep.decelerate_after)/prep.maximum_speed;
             mm_remaining = prep.decelerate_after; // NOTE: 0.0 at EOB
             prep.ramp_type = RAMP_DECEL;
+            #ifdef S_CURVE_PROFILE
+              st_scurve_start(prep.exit_speed, pl_block->acceleration, mm_remaining, prep.mm_complete);
+            #endif
           } else { //仅限巡航。
             mm_remaining = mm_var;
           }
           break;
         default: //斜坡减速情况：注：mm_var用作misc辅助变量，以防止接近零速度时出现错误。
-          speed_var = pl_block->acceleration*time_var; //用作增量速度（毫米/分钟）
-          if (prep.current_speed > speed_var) { //检查是否处于或低于零速。计算段末端到块末端的距离。
-            mm_var = mm_remaining - time_var*(prep.current_speed - 0.5*speed_var); //（毫米）
-            if (mm_var > prep.mm_complete) { //典型案例。在减速坡道上。
-              mm_remaining = mm_var;
-              prep.current_speed -= speed_var;
-              break; //段完成。退出开关案例语句。继续边做边循环。
+          #ifdef S_CURVE_PROFILE
+            if (st_scurve_advance(&time_var, &mm_remaining)) { break; }
+            //在挡块末端或强制减速末端。斜坡的时间由距离决定，速度在这里到达出口速度。
+            mm_remaining = prep.mm_complete;
+            prep.current_speed = prep.exit_speed;
+          #else
+            speed_var = pl_block->acceleration*time_var; //用作增量速度（毫米/分钟）
+            if (prep.current_speed > speed_var) { //检查是否处于或低于零速。计算段末端到块末端的距离。
+              mm_var = mm_remaining - time_var*(prep.current_speed - 0.5*speed_var); //（毫米）
+              if (mm_var > prep.mm_complete) { //典型案例。在减速坡道上。
+                mm_remaining = mm_var;
+                prep.current_speed -= speed_var;
+                break; //段完成。退出开关案例语句。继续边做边循环。
+              }
             }
-          }
-          //否则，在挡块末端或强制减速末端。
-          time_var = 2.0*(mm_remaining-prep.mm_complete)/(prep.current_speed+prep.exit_speed);
-          mm_remaining = prep.mm_complete;
-          prep.current_speed = prep.exit_speed;
+            //否则，在挡块末端或强制减速末端。
+            time_var = 2.0*(mm_remaining-prep.mm_complete)/(prep.current_speed+prep.exit_speed);
+            mm_remaining = prep.mm_complete;
+            prep.current_speed = prep.exit_speed;
+          #endif
       }
       dt += time_var; //将计算的爬坡时间添加到总分段时间。
       if (dt < dt_max) { time_var = dt_max - dt; } // **未完成** 在斜坡结点。
@@ -882,6 +1504,7 @@ void st_prep_buffer()
         }
       }
     } while (mm_remaining > prep.mm_complete); //**完成**退出循环。剖面完成。
+    #endif
 
     #ifdef VARIABLE_SPINDLE
       /*-----------------------------------------------------------------------------------
@@ -912,10 +1535,15 @@ void st_prep_buffer()
        但是，由于浮点数只有7.2个有效数字，具有极高步计数的长移动可能会超过浮点数的精度，从而导致步丢失。 
        幸运的是，在Grbl支持的CNC机床中，这种情况极不可能也不现实（即以200步/毫米的速度超过10米的轴行程）。
     */
-    float step_dist_remaining = prep.step_per_mm*mm_remaining; //将mm_remaining转换为步
-    float n_steps_remaining = ceil(step_dist_remaining); // 当前剩余步数向上取整
-    float last_n_steps_remaining = ceil(prep.steps_remaining); // 最后剩余步数向上取整
-    prep_segment->n_step = last_n_steps_remaining-n_steps_remaining; //计算要执行的步骤数。
+    #ifdef ST_PREP_FIXED_POINT
+      uint32_t n_steps_remaining = (fx_remaining + ST_FX_DIST_MASK) & ~ST_FX_DIST_MASK; // 当前剩余步数向上取整
+      prep_segment->n_step = (prep.steps_remaining - n_steps_remaining) >> ST_FX_DIST_SHIFT; //计算要执行的步骤数。
+    #else
+      float step_dist_remaining = prep.step_per_mm*mm_remaining; //将mm_remaining转换为步
+      float n_steps_remaining = ceil(step_dist_remaining); // 当前剩余步数向上取整
+      float last_n_steps_remaining = ceil(prep.steps_remaining); // 最后剩余步数向上取整
+      prep_segment->n_step = last_n_steps_remaining-n_steps_remaining; //计算要执行的步骤数。
+    #endif
 
     //如果我们处于进给保持的末尾，并且没有步要执行，就退出。
     if (prep_segment->n_step == 0) {
@@ -935,15 +1563,54 @@ void st_prep_buffer()
     //因为由于AMASS算法，步进ISR需要整个步进。
     //为了补偿，我们跟踪执行前一段的部分步长的时间，并简单地将其与部分步长距离一起应用于当前段，这样它就可以精确地调整整个段速率，以保持步长输出的精确性。
     //这些速率调整通常非常小，不会对性能产生不利影响，但可确保Grbl输出规划师计算的准确加速度和速度剖面。
-    dt += prep.dt_remainder; //应用上一段部分步骤执行时间
-    float inv_rate = dt/(last_n_steps_remaining - step_dist_remaining); //计算调整步进速率逆
-
-    //计算预处理段每一步的CPU周期。
-    uint32_t cycles = ceil( (TICKS_PER_MICROSECOND*1000000*60)*inv_rate ); //（周期/步）
+    #ifdef ST_PREP_FIXED_POINT
+      //段时间换算为CPU周期，加上上一段部分步的时间，再除以本段的精确步距。
+      uint32_t dt_cycles = (dt >> ST_FX_TIME_SHIFT)*ST_FX_CYCLES_PER_SEGMENT +
+                           (((dt & ST_FX_TIME_MASK)*ST_FX_CYCLES_PER_SEGMENT) >> ST_FX_TIME_SHIFT) + prep.dt_remainder;
+      uint32_t step_dist = prep.steps_remaining - fx_remaining;
+      if (step_dist == 0) { step_dist = 1; }
+      uint32_t cycles; //（周期/步），向上取整
+      if (dt_cycles < (1UL << (32-ST_FX_DIST_SHIFT))) { cycles = ((dt_cycles << ST_FX_DIST_SHIFT) + step_dist - 1)/step_dist; }
+      else { cycles = (dt_cycles/step_dist) << ST_FX_DIST_SHIFT; } //超过一秒的段，精度无关紧要。
+      //下面都会把这么慢的速率设为最低速度。限制它以免计算剩余时间时溢出。
+      if (cycles > (1UL << 23)) { cycles = (1UL << 23); }
+      //本段最后部分步的时间。与浮点版本一样按未取整的速率计算，否则向上取整的误差经余数带进下一段，匀速时速率会一直偏慢一个周期。
+      uint32_t dt_remainder;
+      if (dt_cycles < (1UL << (32-ST_FX_DIST_SHIFT))) { dt_remainder = ((n_steps_remaining - fx_remaining)*dt_cycles)/step_dist; }
+      else { dt_remainder = ((n_steps_remaining - fx_remaining)*cycles) >> ST_FX_DIST_SHIFT; }
+    #else
+      dt += prep.dt_remainder; //应用上一段部分步骤执行时间
+      float inv_rate = dt/(last_n_steps_remaining - step_dist_remaining); //计算调整步进速率逆
+
+      //计算预处理段每一步的CPU周期。
+      #ifdef NATIVE_ARC_BLOCKS
+        float step_inv_rate = inv_rate;
+        if (pl_block->arc.angular_travel != 0.0) {
+          //圆弧块的段按虚拟步划分，实际执行到段终点的弦。弦的步数不同，执行时间不变。
+          uint16_t n_virtual_step = prep_segment->n_step;
+          prep_segment->n_step = st_prep_arc_chord(prep_segment, n_steps_remaining);
+          if (prep_segment->n_step) { step_inv_rate *= (float)n_virtual_step/prep_segment->n_step; }
+        }
+        uint32_t cycles = ceil( (TICKS_PER_MICROSECOND*1000000*60)*step_inv_rate ); //（周期/步）
+      #else
+        uint32_t cycles = ceil( (TICKS_PER_MICROSECOND*1000000*60)*inv_rate ); //（周期/步）
+      #endif
+    #endif
 
     #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
       //计算步长定时和多轴平滑级别。
       //注意：AMASS在每个级别都会使计时器超速，因此只需要一个预分频器。
+      #ifdef AMASS_RUNTIME_CUTOFFS
+        //每步周期数每超过一次加倍的截止值就升一级，最高到$39级。
+        uint32_t amass_cycles = amass_cutoff_cycles;
+        prep_segment->AMASS_level = 0;
+        while ((cycles >= amass_cycles) && (prep_segment->AMASS_level < settings.amass_max_level)) {
+          prep_segment->AMASS_level++;
+          amass_cycles <<= 1;
+        }
+        cycles >>= prep_segment->AMASS_level;
+        prep_segment->n_step <<= prep_segment->AMASS_level;
+      #else
       if (cycles < AMASS_LEVEL1) { prep_segment->AMASS_level = 0; }
       else {
         if (cycles < AMASS_LEVEL2) { prep_segment->AMASS_level = 1; }
@@ -952,6 +1619,7 @@ void st_prep_buffer()
         cycles >>= prep_segment->AMASS_level;
         prep_segment->n_step <<= prep_segment->AMASS_level;
       }
+      #endif
       if (cycles < (1UL << 16)) { prep_segment->cycles_per_tick = cycles; } // < 65536 (4.1ms @ 16MHz)
       else { prep_segment->cycles_per_tick = 0xffff; } //只需设置尽可能低的速度。
     #else
@@ -972,17 +1640,35 @@ void st_prep_buffer()
       }
     #endif
 
+    #ifdef NATIVE_ARC_BLOCKS
+    if (prep_segment->n_step == 0) {
+      //圆弧很慢时弦上可能没有步。不生成段，执行时间留给下一段。
+      prep.dt_remainder = dt;
+    } else {
+    #endif
     //段完成！增加段缓冲区索引，以便步进ISR可以立即执行它。
-    segment_buffer_head = segment_next_head;
+    st_publish_segment_buffer_head(segment_next_head);
     if ( ++segment_next_head == SEGMENT_BUFFER_SIZE ) { segment_next_head = 0; }
 
     //更新相应的规划器和部门数据。
-    pl_block->millimeters = mm_remaining;
     prep.steps_remaining = n_steps_remaining;
-    prep.dt_remainder = (n_steps_remaining - step_dist_remaining)*inv_rate;
+    #ifdef ST_PREP_FIXED_POINT
+      prep.dt_remainder = dt_remainder;
+    #else
+      prep.dt_remainder = (n_steps_remaining - step_dist_remaining)*inv_rate;
+    #endif
+    #ifdef NATIVE_ARC_BLOCKS
+    }
+    #endif
+    pl_block->millimeters = mm_remaining;
 
     //检查退出条件并标记以加载下一个规划器块。
-    if (mm_remaining == prep.mm_complete) {
+    #ifdef ST_PREP_FIXED_POINT
+      prep.fx_remaining = fx_remaining;
+      if (fx_remaining == prep.fx_complete) {
+    #else
+      if (mm_remaining == prep.mm_complete) {
+    #endif
       //计划块结束或强制终止。没有更多的距离要执行。
       if (mm_remaining > 0.0) { // 在强制终止结束时。
         // 重置恢复准备参数，然后退出。
@@ -1000,6 +1686,9 @@ void st_prep_buffer()
         }
         pl_block = NULL; //设置指针以指示检查并加载下一个规划器块。
         plan_discard_current_block();
+        #ifdef REPORT_SEGMENT_UNDERRUNS
+          prep_block_pending = (plan_get_current_block() != NULL); //段缓冲区已满时要等下次查询才更新，程序结束时会误计
+        #endif
       }
     }
 
@@ -1017,3 +1706,15 @@ float st_get_realtime_rate()
   }
   return 0.0f;
 }
+
+#ifdef REPORT_SEGMENT_UNDERRUNS
+  //由实时状态报告调用。计数由步进中断更新，读取时关中断。
+  uint16_t st_get_segment_underruns()
+  {
+    uint8_t sreg = SREG;
+    cli();
+    uint16_t count = segment_underrun_count;
+    SREG = sreg;
+    return(count);
+  }
+#endif
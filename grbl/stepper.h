@@ -19,6 +19,12 @@
   #define SEGMENT_BUFFER_SIZE 6
 #endif
 
+#ifdef AMASS_RUNTIME_CUTOFFS
+  #define MAX_AMASS_LEVEL 6       //$39的上限
+  #define AMASS_MAX_CUTOFF 15000  //$38的上限（Hz）。中断频率不超过它的两倍，即30kHz。
+  #define AMASS_MAX_STEP_EVENTS ((1UL << (31-MAX_AMASS_LEVEL))-1) //块的步数上限。左移MAX_AMASS_LEVEL后，32位Bresenham计数器不会溢出。
+#endif
+
 //初始化并设置步进电机子系统
 void stepper_init();
 
@@ -31,6 +37,11 @@ void st_go_idle();
 // 生成步进和方向端口反转掩码。
 void st_generate_step_dir_invert_masks();
 
+#ifdef AMASS_RUNTIME_CUTOFFS
+  //由$38生成AMASS截止频率。
+  void st_generate_amass_cutoff();
+#endif
+
 //重置步进机子系统变量
 void st_reset();
 
@@ -49,4 +60,95 @@ void st_update_plan_block_parameters();
 //如果在配置中启用了实时速率报告，则由实时状态报告调用。H
 float st_get_realtime_rate();
 
+#ifdef REPORT_SEGMENT_UNDERRUNS
+  //返回软复位以来段缓冲区欠载的次数，由实时状态报告调用。
+  uint16_t st_get_segment_underruns();
+#endif
+
+#ifdef ST_SEGMENT_HOOK
+  //由主机仿真定义（-DST_SEGMENT_HOOK=函数名）。步进中断每装载一个段调用一次：是否开始新块、步事件数和AMASS级别。
+  //此时OCR1A和TCCR1B已经按新段设置，上一段最后一步的脉冲已经输出。
+  void ST_SEGMENT_HOOK(uint8_t new_block, uint16_t n_step, uint8_t amass_level);
+#endif
+
+#ifdef ISR_PROFILE
+  //中断执行时间统计的分项索引
+  #define ISR_PROFILE_STEP_PULSE     0 //步进中断：从比较匹配到输出方向和步进脉冲
+  #define ISR_PROFILE_STEP_LOAD      1 //步进中断：从段缓冲区装载新段。只在装载时记录。
+  #define ISR_PROFILE_STEP_BRESENHAM 2 //步进中断：Bresenham计数、位置更新和段出队
+  #define ISR_PROFILE_STEP_TOTAL     3 //步进中断：从比较匹配到退出
+  #define ISR_PROFILE_SERIAL_RX      4 //串口接收中断
+  #define ISR_PROFILE_N              5
+
+  //步进中断总时间直方图。每格64个周期，最后一格是512个周期以上，即超过30kHz。
+  #define ISR_PROFILE_HISTOGRAM_SHIFT 6
+  #define ISR_PROFILE_HISTOGRAM_SIZE  9
+
+  typedef struct {
+    uint16_t min;   //CPU周期
+    uint16_t max;
+    uint32_t sum;   //sum/count为平均值。sum将要溢出时两者同时减半。
+    uint32_t count;
+  } isr_profile_t;
+
+  extern isr_profile_t isr_profile[ISR_PROFILE_N];
+  extern uint16_t isr_profile_histogram[ISR_PROFILE_HISTOGRAM_SIZE];
+  //串口接收中断累计的周期数。步进中断开中断后可能被串口接收中断打断，各分项减去这期间的增量。
+  extern volatile uint16_t isr_profile_nested;
+
+  //读取定时器1计数值。定时器1工作在CTC模式，比较匹配时从零开始计数，所以中断中的读数就是从中断触发算起的计数。
+  //注：读取16位寄存器时关中断，避免被其他中断读取TCNT1破坏TEMP寄存器。
+  static inline uint16_t st_profile_timestamp()
+  {
+    uint8_t sreg = SREG;
+    cli();
+    uint16_t ticks = TCNT1;
+    SREG = sreg;
+    return(ticks);
+  }
+
+  //读取嵌套中断的累计周期数。16位变量在AVR上分两次读，关中断读取。
+  static inline uint16_t st_profile_nested()
+  {
+    uint8_t sreg = SREG;
+    cli();
+    uint16_t cycles = isr_profile_nested;
+    SREG = sreg;
+    return(cycles);
+  }
+
+  //把两次读数之差换算为CPU周期数，按当前预分频器缩放，超出范围时取最大值。
+  //注：不启用AMASS时，慢速段的定时器1使用8或64分频，读数按8或64个周期量化。
+  static inline uint16_t st_profile_cycles(uint16_t start, uint16_t end)
+  {
+    if (end < start) { end += OCR1A+1; } //计数器已经过比较值回零
+    uint16_t ticks = end-start;
+    uint8_t prescaler = TCCR1B & (0x07<<CS10);
+    if (prescaler == (2<<CS10)) { return((ticks > 0x1FFF) ? 0xFFFF : (ticks << 3)); }
+    if (prescaler == (3<<CS10)) { return((ticks > 0x03FF) ? 0xFFFF : (ticks << 6)); }
+    return(ticks);
+  }
+
+  //从耗时中减去期间嵌套中断的周期数。
+  static inline uint16_t st_profile_own_cycles(uint16_t cycles, uint16_t nested)
+  {
+    if (cycles == 0xFFFF) { return(cycles); }
+    return((cycles > nested) ? (cycles - nested) : 0);
+  }
+
+  //在中断中记录一次耗时。各分项只由一个中断写入，主程序读取时关中断复制。
+  static inline void st_profile_record(uint8_t idx, uint16_t cycles)
+  {
+    isr_profile_t *profile = &isr_profile[idx];
+    if (cycles < profile->min) { profile->min = cycles; }
+    if (cycles > profile->max) { profile->max = cycles; }
+    profile->sum += cycles;
+    profile->count++;
+    if (profile->sum & 0x80000000) { profile->sum >>= 1; profile->count >>= 1; }
+  }
+
+  //清除中断执行时间统计。
+  void st_profile_reset();
+#endif
+
 #endif
@@ -121,6 +121,9 @@ uint8_t system_execute_line(char *line)
       if(line[2] != '=') { return(STATUS_INVALID_STATEMENT); }
       return(gc_execute_line(line)); //注意：$J=在g代码解析器中被忽略，并用于检测点动运动。
       break;
+    #ifdef ISR_PROFILE
+      case 'P':
+    #endif
     case '$': case 'G': case 'C': case 'X': // 这些开头的命令必须有后面的字符才有意义
       if ( line[2] != 0 ) { return(STATUS_INVALID_STATEMENT); }
       switch( line[1] ) {
@@ -132,6 +135,12 @@ uint8_t system_execute_line(char *line)
           //代办:将其移动到实时命令，以便GUI在挂起状态下请求此数据。
           report_gcode_modes();
           break;
+        #ifdef ISR_PROFILE
+          case 'P' : //打印并清除中断执行时间统计。运行中也可以使用。
+            report_isr_profile();
+            st_profile_reset();
+            break;
+        #endif
         case 'C' : 
           // 设置检查g代码模式[空闲/检查]在关闭时执行复位。
           // 检查g代码模式应仅在Grbl空闲且准备就绪时工作，无论报警锁如何。
@@ -157,6 +157,11 @@ extern volatile uint8_t sys_rt_exec_accessory_override;//主轴/冷却液覆盖
   extern volatile uint8_t sys_rt_exec_debug;
 #endif
 
+#ifdef ISR_PROFILE
+  #define EXEC_ISR_PROFILE_REPORT  bit(0)
+  extern volatile uint8_t sys_rt_exec_isr_profile;
+#endif
+
 //初始化串行协议
 void system_init();
 
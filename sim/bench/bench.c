@@ -0,0 +1,466 @@
+/*
+  bench.c - 规划器和段准备吞吐量基准测试
+  Grbl仿真的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+/*
+  把corpus.c中的程序逐行送进gc_execute_line()，经过mc_line()/mc_arc()进入plan_buffer_line()，
+  再由st_prep_buffer()切成段。这里没有步进中断：每当mc_line()等待规划器缓冲区时，
+  protocol_execute_realtime()的替身把段缓冲区中的段全部取走，然后重新准备，直到规划器有空位。
+  这相当于步进电机跑得无限快，规划器始终处于满缓冲区的稳态，也就是短线段程序最吃紧的情形。
+
+  planner.c和stepper.c直接包含进本文件，以便访问planner_recalculate()和段缓冲区等静态变量。
+  planner.c的函数用-finstrument-functions插桩，用来测量plan_buffer_line()每次调用的耗时（含planner_recalculate()），
+  并统计每次加入块时重新规划访问的块数。启用PLANNER_RECALCULATE_LIMIT或ARC_BATCH_SEGMENTS时，在plan_buffer_line()之外被调用的
+  planner_recalculate()就是被推迟的完整重新规划，它的耗时也计入规划器的吞吐量。
+
+  -o把每个块的步数和执行时间写入文件，-c把它们与这样的文件比较，超出误差时以状态1退出。
+  用来断言两种编译选项（例如浮点和ST_PREP_FIXED_POINT）的段准备结果一致，见README。-x在运行前执行'$'设置。
+
+  -g只测量解析器：程序的各行先生成好，再在检查模式（$C）下送进gc_execute_line()，mc_line()不进入规划器，
+  得到的是每秒解析的行数，用于比较MODAL_FAST_PATH等解析器的改动。
+*/
+
+// grbl/main.c 的 main() 在编译时被改名为 grbl_main()（-Dmain=grbl_main），这里恢复真正的入口。
+#undef main
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include "planner.c"
+#include "stepper.c"
+#include "corpus.h"
+#include "sim.h"
+
+typedef struct {
+  uint32_t lines;
+  uint32_t errors;
+  uint32_t blocks;          // plan_buffer_line()调用次数
+  uint32_t segments;        // 准备好的段数
+  uint64_t steps;           // 所有段的步数之和（去掉AMASS倍数）
+  uint64_t cycles;          // 所有段的执行时间（CPU周期），即加工时间
+  uint32_t checksum;        // 段数据（步数、周期、AMASS级别）的校验和，用于发现行为变化
+  uint64_t plan_ns;         // plan_buffer_line()总耗时（含planner_recalculate()）
+  uint64_t plan_max_ns;     // 单次plan_buffer_line()最长耗时，即最坏的加入延迟
+  uint64_t prep_ns;         // st_prep_buffer()总耗时
+  uint32_t recalc_visits;   // 单次planner_recalculate()访问的块数（plan_prev/next_block_index调用次数）
+  uint32_t recalc_max_visits; // 加入块时单次重新规划最多访问的块数
+  uint32_t deferred;        // 在plan_buffer_line()之外的重新规划次数
+} bench_result_t;
+
+static bench_result_t result;
+static uint8_t bench_verbose;
+
+// 块剖面：每个块的步数和执行时间（CPU周期）。段的st_block_index改变时一个块结束，块中途重新计算剖面时不变。
+// 块的边界落在两步之间，边界附近的一步可以算进相邻的任一块，所以块的误差以步周期计，程序的总时间另外按相对误差检查。
+// 两种版本都把每步的周期数向上取整，步进速率高时这一项也不可忽略，所以每步再允许差一个周期。
+#define PROFILE_TOLERANCE_STEPS 2   // 块执行时间的误差上限（参考块的平均步周期）
+#define PROFILE_TOLERANCE 0.001     // 程序总执行时间的相对误差上限
+#define PROFILE_TOLERANCE_CYCLES_PER_STEP 1
+static FILE *profile_out, *profile_ref;
+static uint8_t profile_block_index;
+static uint32_t profile_steps;
+static uint64_t profile_cycles;
+static uint64_t profile_total, profile_ref_total;  // 程序的总执行时间
+static uint64_t profile_total_steps;
+static uint32_t profile_blocks, profile_failures;
+static double profile_worst_steps, profile_worst;   // 块的最大误差（步周期）和程序总时间的最大相对误差
+
+// 插桩计时状态
+static uint64_t plan_start, recalc_start;
+static uint8_t in_plan, in_recalc;
+static uint32_t wait_blocks; // 上次执行运动时的块数
+
+
+static uint64_t bench_now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((uint64_t)ts.tv_sec*1000000000ULL + ts.tv_nsec);
+}
+
+
+void __cyg_profile_func_enter(void *func, void *caller) __attribute__((no_instrument_function));
+void __cyg_profile_func_exit(void *func, void *caller) __attribute__((no_instrument_function));
+
+void __cyg_profile_func_enter(void *func, void *caller)
+{
+  if (func == (void *)plan_buffer_line) {
+    in_plan = true;
+    plan_start = bench_now();
+  } else if (func == (void *)planner_recalculate) {
+    in_recalc = true;
+    result.recalc_visits = 0;
+    if (!in_plan) {
+      result.deferred++;
+      recalc_start = bench_now();
+    }
+  } else if (in_recalc && ((func == (void *)plan_prev_block_index) || (func == (void *)plan_next_block_index))) {
+    result.recalc_visits++;
+  }
+}
+
+void __cyg_profile_func_exit(void *func, void *caller)
+{
+  if (func == (void *)plan_buffer_line) {
+    uint64_t ns = bench_now()-plan_start;
+    in_plan = false;
+    result.plan_ns += ns;
+    if (ns > result.plan_max_ns) { result.plan_max_ns = ns; }
+    result.blocks++;
+  } else if (func == (void *)planner_recalculate) {
+    in_recalc = false;
+    if (!in_plan) { result.plan_ns += bench_now()-recalc_start; }
+    if (in_plan && (result.recalc_visits > result.recalc_max_visits)) { result.recalc_max_visits = result.recalc_visits; }
+  }
+}
+
+
+// 写出或比较一个块的剖面。
+static void profile_block()
+{
+  if (profile_steps == 0) { return; }
+  profile_blocks++;
+  if (profile_out) { fprintf(profile_out, "%u %llu\n", profile_steps, (unsigned long long)profile_cycles); }
+  if (profile_ref) {
+    unsigned ref_steps = 0;
+    unsigned long long ref_cycles = 0;
+    if (fscanf(profile_ref, " %u %llu", &ref_steps, &ref_cycles) != 2) { ref_steps = 0; }
+    double diff = fabs((double)profile_cycles-(double)ref_cycles) - (double)PROFILE_TOLERANCE_CYCLES_PER_STEP*ref_steps;
+    double error = (ref_steps && (diff > 0.0)) ? diff*ref_steps/ref_cycles : 0.0;
+    if (error > profile_worst_steps) { profile_worst_steps = error; }
+    profile_total += profile_cycles;
+    profile_ref_total += ref_cycles;
+    profile_total_steps += ref_steps;
+    if ((profile_steps != ref_steps) || (error > PROFILE_TOLERANCE_STEPS)) {
+      if (profile_failures < 10) {
+        fprintf(stderr, "block %u: steps %u cycles %llu, reference steps %u cycles %llu\n", profile_blocks,
+                profile_steps, (unsigned long long)profile_cycles, ref_steps, ref_cycles);
+      }
+      profile_failures++;
+    }
+  }
+  profile_steps = 0;
+  profile_cycles = 0;
+}
+
+
+// 比较一个程序的总执行时间。逐块的误差可以互相抵消，这里检查的是累积的偏差。
+static void profile_program(const corpus_program_t *program)
+{
+  profile_block();
+  if (profile_ref && profile_ref_total) {
+    double diff = fabs((double)profile_total-(double)profile_ref_total) - (double)PROFILE_TOLERANCE_CYCLES_PER_STEP*profile_total_steps;
+    double rel = (diff > 0.0) ? diff/profile_ref_total : 0.0;
+    if (rel > profile_worst) { profile_worst = rel; }
+    if (rel > PROFILE_TOLERANCE) {
+      fprintf(stderr, "%s: time %.3f s, reference %.3f s\n", program->name, (double)profile_total/F_CPU, (double)profile_ref_total/F_CPU);
+      profile_failures++;
+    }
+  }
+  profile_total = 0;
+  profile_ref_total = 0;
+  profile_total_steps = 0;
+}
+
+
+// 代替步进中断：取走段缓冲区中所有已准备好的段。
+static void bench_consume_segments()
+{
+  while (segment_buffer_tail != segment_buffer_head) {
+    segment_t *segment = &segment_buffer[segment_buffer_tail];
+    if (segment->st_block_index != profile_block_index) {
+      profile_block();
+      profile_block_index = segment->st_block_index;
+    }
+    #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+      profile_steps += segment->n_step >> segment->AMASS_level;
+      profile_cycles += (uint32_t)segment->n_step*segment->cycles_per_tick;
+    #else
+      profile_steps += segment->n_step;
+      profile_cycles += ((uint32_t)segment->n_step*segment->cycles_per_tick) << (3*(segment->prescaler-1));
+    #endif
+    result.segments++;
+    #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+      result.steps += segment->n_step >> segment->AMASS_level;
+      result.cycles += (uint32_t)segment->n_step*segment->cycles_per_tick;
+      result.checksum = result.checksum*31 + (((uint32_t)segment->n_step << 18) ^ ((uint32_t)segment->cycles_per_tick << 2) ^ segment->AMASS_level);
+    #else
+      result.steps += segment->n_step;
+      result.cycles += ((uint32_t)segment->n_step*segment->cycles_per_tick) << (3*(segment->prescaler-1));
+      result.checksum = result.checksum*31 + (((uint32_t)segment->n_step << 18) ^ ((uint32_t)segment->cycles_per_tick << 2) ^ segment->prescaler);
+    #endif
+    segment_buffer_tail++;
+    if (segment_buffer_tail == SEGMENT_BUFFER_SIZE) { segment_buffer_tail = 0; }
+  }
+}
+
+
+// 段准备一次并计时。
+static void bench_prep()
+{
+  uint64_t start = bench_now();
+  st_prep_buffer();
+  result.prep_ns += bench_now()-start;
+}
+
+
+// 执行缓冲区中的运动：all为false时只执行到规划器有空位，为true时全部执行完。
+// 调用者没有加入新块就再次调用时（例如mc_arc()等待多个空位），每次多执行完一个块，相当于时间在流逝。
+static void bench_run(uint8_t all)
+{
+  uint8_t free_blocks = 1;
+  if (result.blocks == wait_blocks) { free_blocks = min(plan_get_block_buffer_available()+1, BLOCK_BUFFER_SIZE-1); }
+  wait_blocks = result.blocks;
+  for (;;) {
+    bench_consume_segments();
+    if (!all && (plan_get_block_buffer_available() >= free_blocks)) { return; }
+    #ifdef PLANNER_DEFERRED_RECALCULATE
+      plan_recalculate_deferred(); // 与mc_line()等待规划器空位和protocol_buffer_synchronize()相同
+    #endif
+    if (all && (plan_get_current_block() == NULL) && (segment_buffer_tail == segment_buffer_head)) { return; }
+    bench_prep();
+    if (all && (plan_get_current_block() == NULL) && (segment_buffer_tail == segment_buffer_head)) { return; }
+  }
+}
+
+
+// protocol.c的替身
+void protocol_main_loop() { }
+void protocol_exec_rt_system() { }
+void protocol_auto_cycle_start() { }
+void protocol_execute_realtime() { bench_run(false); }
+void protocol_buffer_synchronize()
+{
+  #ifdef PATH_BLENDING
+    mc_blend_flush();
+  #endif
+  bench_run(true);
+}
+
+// serial.c的替身。Grbl的输出只在-v时打印到stderr。
+void serial_init() { }
+void serial_write(uint8_t data) { if (bench_verbose) { fputc(data, stderr); } }
+uint8_t serial_read() { return(SERIAL_NO_DATA); }
+void serial_reset_read_buffer() { }
+uint8_t serial_get_rx_buffer_available() { return(RX_BUFFER_SIZE); }
+uint8_t serial_get_rx_buffer_count() { return(0); }
+uint8_t serial_get_tx_buffer_count() { return(0); }
+
+// 中断和延时的替身。没有中断需要调度。
+void sim_sei() { SREG |= (1<<SREG_I); }
+void sim_cli() { SREG &= ~(1<<SREG_I); }
+void sim_delay_cycles(uint32_t cycles) { }
+
+
+static void bench_emit(char *line)
+{
+  result.lines++;
+  uint8_t status = gc_execute_line(line);
+  if (status != STATUS_OK) {
+    result.errors++;
+    if (bench_verbose) { fprintf(stderr, "error:%d %s\n", status, line); }
+  }
+}
+
+
+// 与grbl/main.c中每次复位时的初始化相同。
+static void bench_reset(uint8_t laser_mode)
+{
+  memset(&sys, 0, sizeof(system_t));
+  sys.state = STATE_IDLE;
+  sys.f_override = DEFAULT_FEED_OVERRIDE;
+  sys.r_override = DEFAULT_RAPID_OVERRIDE;
+  sys.spindle_speed_ovr = DEFAULT_SPINDLE_SPEED_OVERRIDE;
+  memset(sys_position, 0, sizeof(sys_position));
+  if (laser_mode) { settings.flags |= BITFLAG_LASER_MODE; }
+  else { settings.flags &= ~BITFLAG_LASER_MODE; }
+  gc_init();
+  spindle_init();
+  coolant_init();
+  plan_reset();
+  #ifdef PATH_BLENDING
+    mc_blend_reset();
+  #endif
+  st_reset();
+  plan_sync_position();
+  gc_sync_position();
+}
+
+
+static void bench_program(const corpus_program_t *program)
+{
+  memset(&result, 0, sizeof(result));
+  bench_reset(program->laser_mode);
+  // 段准备只在运行状态下进行，这里一开始就当作循环已启动。
+  sys.state = STATE_CYCLE;
+  program->generate(bench_emit);
+  protocol_buffer_synchronize();
+  profile_program(program);
+  sys.state = STATE_IDLE;
+}
+
+
+// 解析器基准测试：记下程序的各行，然后在检查模式下计时执行。
+static char **parse_lines;
+static uint32_t parse_count, parse_size;
+
+static void bench_record(char *line)
+{
+  if (parse_count == parse_size) {
+    parse_size = parse_size ? 2*parse_size : 4096;
+    parse_lines = realloc(parse_lines, parse_size*sizeof(char *));
+    if (parse_lines == NULL) { perror("bench"); exit(1); }
+  }
+  parse_lines[parse_count++] = strdup(line);
+}
+
+
+static void bench_parse(const corpus_program_t *program, int repeats)
+{
+  uint32_t idx;
+  for (idx=0; idx<parse_count; idx++) { free(parse_lines[idx]); }
+  parse_count = 0;
+  program->generate(bench_record);
+
+  uint64_t best_ns = UINT64_MAX;
+  uint32_t errors = 0;
+  int run;
+  for (run=0; run<repeats; run++) {
+    bench_reset(program->laser_mode);
+    sys.state = STATE_CHECK_MODE;
+    errors = 0;
+    uint64_t start = bench_now();
+    for (idx=0; idx<parse_count; idx++) {
+      if (gc_execute_line(parse_lines[idx]) != STATUS_OK) { errors++; }
+    }
+    uint64_t ns = bench_now()-start;
+    if (ns < best_ns) { best_ns = ns; }
+  }
+  sys.state = STATE_IDLE;
+  printf("%-14s %7u %7u %10.0f %9.3f\n", program->name, parse_count, errors,
+         parse_count/(best_ns*1e-9), best_ns*1e-3/parse_count);
+}
+
+
+static void usage(const char *name)
+{
+  fprintf(stderr,
+    "usage: %s [-r repeats] [-p program] [-g] [-v] [-x setting]... [-o profile | -c profile]\n"
+    "  -r  run each program this many times and keep the fastest (default 3)\n"
+    "  -p  only run the named program\n"
+    "  -g  only measure the G-code parser (check mode, no planner)\n"
+    "  -v  print Grbl output and G-code errors\n"
+    "  -x  apply a '$' setting before running, e.g. -x '$100=800'\n"
+    "  -o  write the steps and time of each block to a file\n"
+    "  -c  compare the steps and time of each block with a file written by -o; exit 1 on mismatch\n",
+    name);
+  exit(1);
+}
+
+
+int main(int argc, char *argv[])
+{
+  const char *only = NULL;
+  int repeats = 3;
+  uint8_t parse_only = false;
+  char *setting_lines[16];
+  int setting_count = 0;
+  int opt;
+  uint8_t idx;
+
+  while ((opt = getopt(argc, argv, "r:p:gvx:o:c:h")) != -1) {
+    switch (opt) {
+      case 'r': repeats = atoi(optarg); break;
+      case 'p': only = optarg; break;
+      case 'g': parse_only = true; break;
+      case 'v': bench_verbose = true; break;
+      case 'x':
+        if (setting_count == 16) { usage(argv[0]); }
+        setting_lines[setting_count++] = optarg;
+        break;
+      case 'o':
+        profile_out = fopen(optarg, "w");
+        if (profile_out == NULL) { perror(optarg); exit(1); }
+        break;
+      case 'c':
+        profile_ref = fopen(optarg, "r");
+        if (profile_ref == NULL) { perror(optarg); exit(1); }
+        break;
+      default: usage(argv[0]);
+    }
+  }
+  if (repeats < 1) { usage(argv[0]); }
+  if (profile_out || profile_ref) { repeats = 1; } //剖面只写一次
+
+  sim_eeprom_init(NULL);
+  settings_init();
+  stepper_init();
+  system_init();
+  for (opt=0; opt<setting_count; opt++) {
+    char line[LINE_BUFFER_SIZE];
+    strncpy(line, setting_lines[opt], LINE_BUFFER_SIZE-1);
+    line[LINE_BUFFER_SIZE-1] = 0;
+    uint8_t status = system_execute_line(line);
+    if (status != STATUS_OK) { fprintf(stderr, "%s: error:%d\n", setting_lines[opt], status); exit(1); }
+  }
+
+  if (parse_only) {
+    printf("%-14s %7s %7s %10s %9s\n", "program", "lines", "errors", "lines/s", "line_us");
+    for (idx=0; idx<corpus_program_count; idx++) {
+      if (only && strcmp(only, corpus_programs[idx].name)) { continue; }
+      bench_parse(&corpus_programs[idx], repeats);
+    }
+    return(0);
+  }
+
+  #ifdef PLANNER_RECALCULATE_LIMIT
+    printf("# BLOCK_BUFFER_SIZE=%d SEGMENT_BUFFER_SIZE=%d ACCELERATION_TICKS_PER_SECOND=%d PLANNER_RECALCULATE_LIMIT=%d\n",
+           BLOCK_BUFFER_SIZE, SEGMENT_BUFFER_SIZE, ACCELERATION_TICKS_PER_SECOND, PLANNER_RECALCULATE_LIMIT);
+  #else
+    printf("# BLOCK_BUFFER_SIZE=%d SEGMENT_BUFFER_SIZE=%d ACCELERATION_TICKS_PER_SECOND=%d\n",
+           BLOCK_BUFFER_SIZE, SEGMENT_BUFFER_SIZE, ACCELERATION_TICKS_PER_SECOND);
+  #endif
+  printf("%-14s %7s %7s %8s %9s %10s %10s %8s %10s %8s %9s %9s %6s %8s\n",
+         "program", "lines", "errors", "blocks", "segments", "steps", "time_s", "checksum",
+         "blocks/s", "segs/s", "insert_us", "worst_us", "visits", "deferred");
+
+  for (idx=0; idx<corpus_program_count; idx++) {
+    const corpus_program_t *program = &corpus_programs[idx];
+    if (only && strcmp(only, program->name)) { continue; }
+
+    bench_result_t best;
+    uint64_t worst = UINT64_MAX;
+    int run;
+    for (run=0; run<repeats; run++) {
+      bench_program(program);
+      // 计数部分每次都相同。耗时取最快的一次，最长单次耗时也取各次中最小的，以减少调度噪声。
+      if (result.plan_max_ns < worst) { worst = result.plan_max_ns; }
+      if ((run == 0) || (result.plan_ns+result.prep_ns < best.plan_ns+best.prep_ns)) { best = result; }
+    }
+    best.plan_max_ns = worst;
+
+    printf("%-14s %7u %7u %8u %9u %10llu %10.3f %08x %10.0f %10.0f %9.3f %9.3f %6u %8u\n",
+           program->name, best.lines, best.errors, best.blocks, best.segments,
+           (unsigned long long)best.steps, (double)best.cycles/F_CPU, best.checksum,
+           best.blocks/(best.plan_ns*1e-9), best.segments/(best.prep_ns*1e-9),
+           best.blocks ? best.plan_ns*1e-3/best.blocks : 0.0,
+           best.plan_max_ns*1e-3, best.recalc_max_visits, best.deferred);
+  }
+  if (profile_out) { fclose(profile_out); }
+  if (profile_ref) {
+    unsigned extra;
+    if (fscanf(profile_ref, " %u", &extra) == 1) { profile_failures++; fprintf(stderr, "reference has more blocks\n"); }
+    printf("# profile: %u blocks, %u mismatches, worst block error %.2f steps, worst program time error %.4f%%\n",
+           profile_blocks, profile_failures, profile_worst_steps, 100.0*profile_worst);
+    if (profile_failures) { return(1); }
+  }
+  return(0);
+}
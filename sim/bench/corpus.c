@@ -0,0 +1,137 @@
+/*
+  corpus.c - 基准测试用的G代码程序
+  Grbl仿真的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include "corpus.h"
+
+// 注意：gc_execute_line()要求大写、无空格，和protocol_main_loop()预处理之后的格式一致。
+
+
+// 三维曲面精加工：40x40mm的波浪面，行距0.5mm，每0.1mm一段G1。典型的CAM短线段输出。
+static void corpus_surface3d(corpus_emit_t emit)
+{
+  char line[80];
+  int row, col;
+  emit("G21G90G94G17");
+  emit("G0Z5.000");
+  emit("G0X0.000Y0.000");
+  emit("G1Z0.000F600");
+  emit("F1500");
+  for (row=0; row<=80; row++) {
+    float y = 0.5f*row;
+    for (col=0; col<=400; col++) {
+      float x = 0.1f*((row & 1) ? (400-col) : col);
+      float z = 2.0f*sinf(x/7.0f)*cosf(y/5.0f) - 2.0f;
+      snprintf(line, sizeof(line), "G1X%.3fY%.3fZ%.3f", x, y, z);
+      emit(line);
+    }
+  }
+  emit("G0Z5.000");
+}
+
+
+// 2.5D圆弧型腔：4个型腔，每个3层，每层由内向外20圈整圆（两段半圆）组成，圈之间用G1连接。
+static void corpus_arc_pocket(corpus_emit_t emit)
+{
+  char line[80];
+  int pocket, depth, ring;
+  emit("G21G90G94G17");
+  emit("F1200");
+  for (pocket=0; pocket<4; pocket++) {
+    float cx = 30.0f + 50.0f*(pocket & 1);
+    float cy = 30.0f + 50.0f*(pocket >> 1);
+    snprintf(line, sizeof(line), "G0Z5.000");
+    emit(line);
+    snprintf(line, sizeof(line), "G0X%.3fY%.3f", cx, cy);
+    emit(line);
+    for (depth=1; depth<=3; depth++) {
+      snprintf(line, sizeof(line), "G1Z%.3f", -1.0f*depth);
+      emit(line);
+      for (ring=1; ring<=20; ring++) {
+        float r = 1.0f*ring;
+        snprintf(line, sizeof(line), "G1X%.3fY%.3f", cx+r, cy);
+        emit(line);
+        snprintf(line, sizeof(line), "G2X%.3fY%.3fI%.3fJ0", cx-r, cy, -r);
+        emit(line);
+        snprintf(line, sizeof(line), "G2X%.3fY%.3fI%.3fJ0", cx+r, cy, r);
+        emit(line);
+      }
+      snprintf(line, sizeof(line), "G3X%.3fY%.3fR10.000", cx+10.0f, cy+10.0f);
+      emit(line);
+      snprintf(line, sizeof(line), "G1X%.3fY%.3f", cx, cy);
+      emit(line);
+    }
+  }
+  emit("G0Z5.000");
+}
+
+
+// 激光灰度雕刻：50x10mm，行距0.1mm，双向扫描，每0.1mm一个像素，每个像素一段G1并改变S功率。
+static void corpus_laser_raster(corpus_emit_t emit)
+{
+  char line[80];
+  int row, col;
+  emit("G21G90G94");
+  emit("G0X0.000Y0.000");
+  emit("M4S0");
+  emit("F3000");
+  for (row=0; row<100; row++) {
+    float y = 0.1f*row;
+    snprintf(line, sizeof(line), "G1Y%.3fS0", y);
+    emit(line);
+    for (col=1; col<=500; col++) {
+      int px = (row & 1) ? (500-col) : col;
+      int s = (int)(500.0f + 499.0f*sinf(0.05f*px)*cosf(0.11f*row));
+      snprintf(line, sizeof(line), "G1X%.3fS%d", 0.1f*px, s);
+      emit(line);
+    }
+  }
+  emit("M5S0");
+}
+
+
+// 平面轮廓：多边形轮廓由内向外偏置10圈，每条边都被切成0.05mm的共线G1。常见于由网格或点云生成的CAM输出。
+static void corpus_polyline(corpus_emit_t emit)
+{
+  char line[80];
+  int ring, side, step;
+  emit("G21G90G94G17");
+  emit("G0Z5.000");
+  emit("G0X20.000Y0.000");
+  emit("G1Z-1.000F600");
+  emit("F2000");
+  for (ring=0; ring<10; ring++) {
+    float r = 20.0f + 2.0f*ring;
+    for (side=0; side<6; side++) {
+      float x0 = r*cosf(side*1.0471976f), y0 = r*sinf(side*1.0471976f);
+      float x1 = r*cosf((side+1)*1.0471976f), y1 = r*sinf((side+1)*1.0471976f);
+      int steps = (int)(hypotf(x1-x0, y1-y0)/0.05f);
+      for (step=1; step<=steps; step++) {
+        float t = (float)step/steps;
+        snprintf(line, sizeof(line), "G1X%.3fY%.3f", x0+t*(x1-x0), y0+t*(y1-y0));
+        emit(line);
+      }
+    }
+    snprintf(line, sizeof(line), "G1X%.3fY0.000", r+2.0f);
+    emit(line);
+  }
+  emit("G0Z5.000");
+}
+
+
+const corpus_program_t corpus_programs[] = {
+  { "surface3d", 0, corpus_surface3d },
+  { "arc_pocket", 0, corpus_arc_pocket },
+  { "laser_raster", 1, corpus_laser_raster },
+  { "polyline", 0, corpus_polyline },
+};
+const uint8_t corpus_program_count = sizeof(corpus_programs)/sizeof(corpus_program_t);
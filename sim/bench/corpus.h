@@ -0,0 +1,30 @@
+/*
+  corpus.h - 基准测试用的G代码程序
+  Grbl仿真的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+#ifndef corpus_h
+#define corpus_h
+
+#include <stdint.h>
+
+// 每生成一行G代码调用一次
+typedef void (*corpus_emit_t)(char *line);
+
+typedef struct {
+  const char *name;
+  uint8_t laser_mode;   // 是否以激光模式（$32=1）运行
+  void (*generate)(corpus_emit_t emit);
+} corpus_program_t;
+
+// 程序都是按公式生成的，每次运行完全相同，结果可以在不同提交之间直接比较。
+extern const corpus_program_t corpus_programs[];
+extern const uint8_t corpus_program_count;
+
+#endif
@@ -0,0 +1,78 @@
+/*
+  eeprom.c - 主机仿真的EEPROM，替换grbl/eeprom.c
+  Grbl仿真的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+#include <stdio.h>
+#include "grbl.h"
+#include "sim.h"
+
+// EEPROM内容保存在内存中，擦除状态为0xFF。可以用 -e 选项从文件加载并在退出时写回。
+static unsigned char sim_eeprom[E2END+1];
+static const char *sim_eeprom_file;
+
+
+static void sim_eeprom_save()
+{
+  FILE *fp = fopen(sim_eeprom_file, "wb");
+  if (fp == NULL) { return; }
+  fwrite(sim_eeprom, 1, sizeof(sim_eeprom), fp);
+  fclose(fp);
+}
+
+
+void sim_eeprom_init(const char *file)
+{
+  memset(sim_eeprom, 0xff, sizeof(sim_eeprom));
+  sim_eeprom_file = file;
+  if (file == NULL) { return; }
+  FILE *fp = fopen(file, "rb");
+  if (fp != NULL) {
+    if (fread(sim_eeprom, 1, sizeof(sim_eeprom), fp) != sizeof(sim_eeprom)) {
+      memset(sim_eeprom, 0xff, sizeof(sim_eeprom));
+    }
+    fclose(fp);
+  }
+  atexit(sim_eeprom_save);
+}
+
+
+unsigned char eeprom_get_char( unsigned int addr )
+{
+  return sim_eeprom[addr & E2END];
+}
+
+
+void eeprom_put_char( unsigned int addr, unsigned char new_value )
+{
+  sim_eeprom[addr & E2END] = new_value;
+}
+
+
+// 以下与grbl/eeprom.c相同，保证校验和与固件一致。
+void memcpy_to_eeprom_with_checksum(unsigned int destination, char *source, unsigned int size) {
+  unsigned char checksum = 0;
+  for(; size > 0; size--) { 
+    checksum = (checksum << 1) || (checksum >> 7);
+    checksum += *source;
+    eeprom_put_char(destination++, *(source++)); 
+  }
+  eeprom_put_char(destination, checksum);
+}
+
+int memcpy_from_eeprom_with_checksum(char *destination, unsigned int source, unsigned int size) {
+  unsigned char data, checksum = 0;
+  for(; size > 0; size--) { 
+    data = eeprom_get_char(source++);
+    checksum = (checksum << 1) || (checksum >> 7);
+    checksum += data;    
+    *(destination++) = data; 
+  }
+  return(checksum == eeprom_get_char(source));
+}
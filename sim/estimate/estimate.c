@@ -0,0 +1,231 @@
+/*
+  estimate.c - 加工时间估算：用机器的$设置，经过真实的解析器、规划器和段准备重放G代码程序
+  Grbl仿真的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+/*
+  按距离/进给估算的时间忽略了加减速和节点偏差，短线段程序往往差20%~40%。这里每行送进gc_execute_line()，
+  再由plan_buffer_line()和st_prep_buffer()算出与机器上相同的速度剖面（见replay.c），段的执行时间之和就是加工时间。
+
+  每个段按步数和执行时间算出速度，低于编程进给的段计入“低于进给”的时间。每行G代码的实际时间与距离/进给之差
+  就是它损失的时间，损失最多的行按原因列出：
+    rate    标称速度受轴的最大速率（$110~$112）限制
+    short   块太短，没有加速到标称速度
+    corner  进入或离开的节点速度不到标称速度的一半（拐角或停止）
+*/
+
+// grbl/main.c 的 main() 在编译时被改名为 grbl_main()（-Dmain=grbl_main），这里恢复真正的入口。
+#undef main
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include "grbl.h"
+#include "replay.h"
+#include "sim.h"
+
+#define ESTIMATE_BELOW_FEED 0.99   // 段速度低于编程进给的这个比例时算作低于进给
+#define ESTIMATE_CORNER 0.5        // 节点速度低于标称速度的这个比例时算作拐角
+
+#define LIMIT_RATE 0
+#define LIMIT_SHORT 1
+#define LIMIT_CORNER 2
+
+typedef struct {
+  uint32_t line;          // 源文件中的行号
+  float millimeters;
+  float programmed_rate;
+  float nominal_speed;
+  float junction_speed;
+  float mm_per_step;
+  float peak_speed;       // 段的最高速度
+  uint64_t cycles;        // 执行时间
+  uint64_t below_cycles;  // 低于编程进给的时间
+} estimate_block_t;
+
+typedef struct {
+  uint32_t line;
+  uint32_t blocks;
+  double millimeters;
+  double ideal_time;      // 距离/进给，秒
+  double time;            // 实际时间，秒
+  float feed;             // 编程进给（最后一个块）
+  float peak_speed;
+  uint8_t limits;         // LIMIT_*位
+} estimate_line_t;
+
+static estimate_block_t *blocks;
+static uint32_t block_count, block_size;
+static uint32_t current_line;
+
+
+static void block_added(replay_block_t *info)
+{
+  if (info->id < block_count) { // 合并后再次报告，块仍然算作第一条线段所在的行
+    estimate_block_t *block = &blocks[info->id];
+    block->millimeters = info->millimeters;
+    block->nominal_speed = info->nominal_speed;
+    block->mm_per_step = info->millimeters/info->step_event_count;
+    return;
+  }
+  if (block_count == block_size) {
+    block_size = block_size ? 2*block_size : 4096;
+    blocks = realloc(blocks, block_size*sizeof(estimate_block_t));
+    if (blocks == NULL) { perror("estimate"); exit(1); }
+  }
+  estimate_block_t *block = &blocks[block_count++];
+  memset(block, 0, sizeof(estimate_block_t));
+  block->line = current_line;
+  block->millimeters = info->millimeters;
+  block->programmed_rate = info->programmed_rate;
+  block->nominal_speed = info->nominal_speed;
+  block->junction_speed = info->junction_speed;
+  // 原生圆弧块的段步数是弦上的实际步数，按虚拟步数换算的速度只是近似值。
+  block->mm_per_step = info->millimeters/info->step_event_count;
+}
+
+
+static void segment_done(uint32_t block_id, uint32_t steps, uint32_t cycles)
+{
+  estimate_block_t *block = &blocks[block_id];
+  block->cycles += cycles;
+  if ((steps == 0) || (cycles == 0)) { return; }
+  float speed = steps*block->mm_per_step*(60.0*F_CPU)/cycles;
+  if (speed > block->peak_speed) { block->peak_speed = speed; }
+  if (speed < ESTIMATE_BELOW_FEED*block->programmed_rate) { block->below_cycles += cycles; }
+}
+
+
+static void usage(const char *name)
+{
+  fprintf(stderr,
+    "usage: %s [-e eeprom] [-s settings] [-n count] input.nc\n"
+    "  -e  load $ settings from an EEPROM file saved by the simulator\n"
+    "  -s  apply $x=value lines from a file, e.g. the machine's $$ output\n"
+    "  -n  number of worst lines to list (default 10)\n",
+    name);
+  exit(1);
+}
+
+
+static FILE *open_file(const char *name)
+{
+  FILE *fp = fopen(name, "r");
+  if (fp == NULL) { perror(name); exit(1); }
+  return(fp);
+}
+
+
+static int compare_lost(const void *a, const void *b)
+{
+  const estimate_line_t *x = a;
+  const estimate_line_t *y = b;
+  double lost_x = x->time-x->ideal_time;
+  double lost_y = y->time-y->ideal_time;
+  if (lost_x < lost_y) { return(1); }
+  if (lost_x > lost_y) { return(-1); }
+  return((x->line > y->line) - (x->line < y->line));
+}
+
+
+int main(int argc, char *argv[])
+{
+  const char *eeprom_file = NULL;
+  const char *settings_file = NULL;
+  int worst = 10;
+  int opt;
+  char line[1024];
+
+  while ((opt = getopt(argc, argv, "e:s:n:h")) != -1) {
+    switch (opt) {
+      case 'e': eeprom_file = optarg; break;
+      case 's': settings_file = optarg; break;
+      case 'n': worst = atoi(optarg); break;
+      default: usage(argv[0]);
+    }
+  }
+  if ((optind != argc-1) || (worst < 0)) { usage(argv[0]); }
+
+  replay_init(eeprom_file);
+  if (settings_file) {
+    FILE *fp = open_file(settings_file);
+    uint32_t number = 0;
+    while (fgets(line, sizeof(line), fp)) {
+      number++;
+      replay_normalize(line);
+      if ((line[0] == '$') && (line[1] >= '0') && (line[1] <= '9')) {
+        uint8_t status = replay_setting(line);
+        if (status != STATUS_OK) { fprintf(stderr, "%s:%u: error:%d %s\n", settings_file, number, status, line); }
+      }
+    }
+    fclose(fp);
+  }
+
+  // 重放程序。源文件中的行号在块进入规划器时记下。
+  FILE *fp = open_file(argv[optind]);
+  replay_block_hook = block_added;
+  replay_segment_hook = segment_done;
+  replay_start(false);
+  while (fgets(line, sizeof(line), fp)) {
+    current_line++;
+    replay_normalize(line);
+    uint8_t status = replay_line(line);
+    if (status != STATUS_OK) { fprintf(stderr, "%s:%u: error:%d %s\n", argv[optind], current_line, status, line); }
+  }
+  replay_finish();
+
+  // 按行汇总。圆弧由多个块组成。
+  estimate_line_t *lines = calloc(current_line+1, sizeof(estimate_line_t));
+  if (lines == NULL) { perror("estimate"); exit(1); }
+  double ideal_time = 0, below_time = 0;
+  uint32_t idx;
+  for (idx=0; idx<block_count; idx++) {
+    estimate_block_t *block = &blocks[idx];
+    estimate_line_t *source = &lines[block->line];
+    float exit_speed = 0;
+    if (idx+1 < block_count) { exit_speed = blocks[idx+1].junction_speed; }
+    source->line = block->line;
+    source->blocks++;
+    source->millimeters += block->millimeters;
+    source->ideal_time += 60.0*block->millimeters/block->programmed_rate;
+    source->time += (double)block->cycles/F_CPU;
+    source->feed = block->programmed_rate;
+    if (block->peak_speed > source->peak_speed) { source->peak_speed = block->peak_speed; }
+    if (block->nominal_speed < ESTIMATE_BELOW_FEED*block->programmed_rate) { source->limits |= bit(LIMIT_RATE); }
+    if (block->peak_speed < ESTIMATE_BELOW_FEED*block->nominal_speed) { source->limits |= bit(LIMIT_SHORT); }
+    if (min(block->junction_speed, exit_speed) < ESTIMATE_CORNER*block->nominal_speed) { source->limits |= bit(LIMIT_CORNER); }
+    ideal_time += 60.0*block->millimeters/block->programmed_rate;
+    below_time += (double)block->below_cycles/F_CPU;
+  }
+
+  double motion_time = (double)replay_result.cycles/F_CPU;
+  double dwell_time = (double)replay_result.dwell_cycles/F_CPU;
+  printf("lines %u, errors %u, blocks %u, segments %u\n",
+         replay_result.lines, replay_result.errors, replay_result.blocks, replay_result.segments);
+  printf("time            %10.3f s  (motion %.3f s, dwell %.3f s)\n", motion_time+dwell_time, motion_time, dwell_time);
+  printf("distance/feed   %10.3f s  (motion is %+.1f%%)\n", ideal_time, ideal_time > 0 ? 100.0*(motion_time/ideal_time-1) : 0.0);
+  printf("below feed      %10.3f s  (%.1f%% of motion)\n", below_time, motion_time > 0 ? 100.0*below_time/motion_time : 0.0);
+
+  if (worst > 0) {
+    qsort(lines, current_line+1, sizeof(estimate_line_t), compare_lost);
+    printf("\n%8s %7s %10s %9s %9s %9s %9s  %s\n", "line", "blocks", "mm", "feed", "peak", "time_s", "lost_s", "limit");
+    for (idx=0; (idx<(uint32_t)worst) && (idx<=current_line) && (lines[idx].blocks > 0); idx++) {
+      estimate_line_t *source = &lines[idx];
+      if (source->time <= source->ideal_time) { break; }
+      printf("%8u %7u %10.3f %9.1f %9.1f %9.3f %9.3f  %s%s%s\n", source->line, source->blocks, source->millimeters,
+             source->feed, source->peak_speed, source->time, source->time-source->ideal_time,
+             bit_istrue(source->limits, bit(LIMIT_RATE)) ? "rate " : "",
+             bit_istrue(source->limits, bit(LIMIT_SHORT)) ? "short " : "",
+             bit_istrue(source->limits, bit(LIMIT_CORNER)) ? "corner" : "");
+    }
+  }
+  return(0);
+}
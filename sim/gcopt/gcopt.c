@@ -0,0 +1,579 @@
+/*
+  gcopt.c - 主机上的G代码预处理器：合并共线的G1、把密集的点拟合成G2/G3圆弧、去掉多余的模态字，并预测加工时间
+  Grbl仿真的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+/*
+  每行先按protocol_main_loop()的规则整理，再由真正的gc_execute_line()在检查模式下执行，
+  所以模态状态、单位、坐标系和出错的行都与机器上完全相同。
+
+  只有“简单”的行会被改写：G90、G94状态下只含G0/G1、X、Y、Z、F（和N）的行。连续的、进给相同的G1终点
+  收集成一段折线，遇到其它行时贪心地用尽量长的直线（中间点偏离不超过-t）或XY平面上的圆弧
+  （顶点和弦的中点偏离都不超过-t）代替。其它行原样输出，输出之前补上它依赖的G0/G1和F模态。
+  输出中的G、F和坐标字只在改变时才写。
+
+  最后把输入和输出分别经过解析器、规划器和段准备重放（见replay.c），在stderr上打印两者的块数和预测的加工时间。
+*/
+
+// grbl/main.c 的 main() 在编译时被改名为 grbl_main()（-Dmain=grbl_main），这里恢复真正的入口。
+#undef main
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include "grbl.h"
+#include "replay.h"
+#include "sim.h"
+
+#define GCOPT_MAX_RUN 256 // 一段折线最多的点数，超过时先输出
+#define GCOPT_ALL_AXES ((1<<N_AXIS)-1)
+
+typedef struct {
+  double tolerance;   // 允许的偏差，mm
+  int decimals;       // 毫米单位时输出的小数位数，英寸单位时多一位
+  uint8_t arcs;       // 是否拟合圆弧
+} gcopt_config_t;
+static gcopt_config_t config = { 0.005, 4, true };
+
+// 输出流中解析器的状态，即机器收到输出之后的模态。
+typedef struct {
+  uint8_t motion;         // 模态运动方式
+  char feed[24];          // 模态进给，按输出格式
+  double position[N_AXIS]; // 程序坐标（已按输出精度舍入）
+  uint8_t known;          // position中有效的轴。开始时和'$'命令（例如$H）之后机器位置未知，这些轴要在写出一次之后才能省略。
+} gcopt_output_t;
+static gcopt_output_t out;
+
+// 正在收集的折线。point[0]是起点。
+typedef struct {
+  double point[GCOPT_MAX_RUN+1][N_AXIS];
+  uint16_t count;     // 终点数
+  char feed[24];
+} gcopt_run_t;
+static gcopt_run_t run;
+
+static char *output;      // 输出的G代码
+static size_t output_len, output_size;
+
+static struct {
+  uint32_t merged;  // 被直线合并掉的G1行
+  uint32_t arcs;    // 拟合出的圆弧
+  uint32_t arc_points; // 被圆弧代替的G1行
+  uint32_t dropped; // 没有运动、被去掉的行
+} stats;
+
+
+static void emit(const char *text)
+{
+  size_t len = strlen(text);
+  if (output_len+len+2 > output_size) {
+    output_size = (output_size+len+2)*2;
+    output = realloc(output, output_size);
+    if (output == NULL) { perror("gcopt"); exit(1); }
+  }
+  memcpy(output+output_len, text, len);
+  output_len += len;
+  output[output_len] = 0;
+}
+
+
+// 当前单位下的小数位数
+static int gcopt_decimals()
+{
+  if (gc_state.modal.units == UNITS_MODE_INCHES) { return(config.decimals+1); }
+  return(config.decimals);
+}
+
+
+// 按小数位数格式化，去掉末尾的0和小数点，"-0"写成"0"。
+static void format_number(char *buf, double value, int decimals)
+{
+  sprintf(buf, "%.*f", decimals, value);
+  if (strchr(buf, '.')) {
+    char *end = buf+strlen(buf)-1;
+    while (*end == '0') { *end-- = 0; }
+    if (*end == '.') { *end = 0; }
+  }
+  if (strcmp(buf, "-0") == 0) { strcpy(buf, "0"); }
+}
+
+
+static double round_value(double value)
+{
+  double scale = pow(10, gcopt_decimals());
+  return(round(value*scale)/scale);
+}
+
+
+// 解析器当前的程序坐标（当前单位），与状态报告中的WPos相同。
+static void program_position(double *position)
+{
+  uint8_t idx;
+  for (idx=0; idx<N_AXIS; idx++) {
+    double value = gc_state.position[idx]-gc_state.coord_system[idx]-gc_state.coord_offset[idx];
+    if (idx == TOOL_LENGTH_OFFSET_AXIS) { value -= gc_state.tool_length_offset; }
+    if (gc_state.modal.units == UNITS_MODE_INCHES) { value /= MM_PER_INCH; }
+    position[idx] = value;
+  }
+}
+
+
+static void current_feed(char *buf)
+{
+  double feed = gc_state.feed_rate;
+  if (gc_state.modal.units == UNITS_MODE_INCHES) { feed /= MM_PER_INCH; }
+  format_number(buf, feed, gcopt_decimals());
+}
+
+
+// 输出一个运动。只写出改变了的模态字和坐标：位置已知的轴在改变时写出，位置未知的轴在行中有坐标字（words）时写出。
+// 没有坐标要写的直线运动不输出。
+static void emit_motion(uint8_t motion, const char *feed, const double *target, uint8_t words, const double *ij)
+{
+  char line[LINE_BUFFER_SIZE*2], word[32];
+  uint8_t idx;
+  line[0] = 0;
+  for (idx=0; idx<N_AXIS; idx++) {
+    double value = round_value(target[idx]);
+    if (bit_istrue(out.known, bit(idx)) ? (value != out.position[idx]) : bit_istrue(words, bit(idx))) {
+      format_number(word, value, gcopt_decimals());
+      sprintf(line+strlen(line), "%c%s", "XYZABC"[idx], word);
+    }
+  }
+  if (ij) {
+    format_number(word, ij[0], gcopt_decimals());
+    sprintf(line+strlen(line), "I%s", word);
+    format_number(word, ij[1], gcopt_decimals());
+    sprintf(line+strlen(line), "J%s", word);
+  } else if (line[0] == 0) {
+    stats.dropped++;
+    return;
+  }
+  if (motion != out.motion) {
+    sprintf(word, "G%d", motion);
+    emit(word);
+    out.motion = motion;
+  }
+  if ((motion != MOTION_MODE_SEEK) && strcmp(feed, out.feed)) {
+    emit("F");
+    emit(feed);
+    strcpy(out.feed, feed);
+  }
+  emit(line);
+  emit("\n");
+  out.known |= words;
+  for (idx=0; idx<N_AXIS; idx++) { out.position[idx] = round_value(target[idx]); }
+}
+
+
+static double distance(const double *a, const double *b)
+{
+  double sum = 0;
+  uint8_t idx;
+  for (idx=0; idx<N_AXIS; idx++) { sum += (a[idx]-b[idx])*(a[idx]-b[idx]); }
+  return(sqrt(sum));
+}
+
+
+// point[first]到point[last]的直线能否代替中间的点：偏差不超过tolerance，沿直线不后退。
+static uint8_t fit_line(uint16_t first, uint16_t last, double tolerance)
+{
+  double *a = run.point[first];
+  double *b = run.point[last];
+  double length = distance(a, b);
+  if (length == 0) { return(false); }
+  double projection = 0;
+  uint16_t k;
+  uint8_t idx;
+  for (k=first+1; k<last; k++) {
+    double t = 0;
+    for (idx=0; idx<N_AXIS; idx++) { t += (run.point[k][idx]-a[idx])*(b[idx]-a[idx]); }
+    t /= length;
+    if ((t < projection) || (t > length)) { return(false); }
+    projection = t;
+    double foot[N_AXIS];
+    for (idx=0; idx<N_AXIS; idx++) { foot[idx] = a[idx]+(b[idx]-a[idx])*t/length; }
+    if (distance(run.point[k], foot) > tolerance) { return(false); }
+  }
+  return(true);
+}
+
+
+// point[first]到point[last]能否用XY平面上的圆弧代替。圆过首、中、末三点，所有顶点和弦的中点到圆的偏差
+// 都不超过tolerance，绕圆心的方向一致且不满一圈，Z不变。成功时返回G2/G3，并填写圆心。
+static uint8_t fit_arc(uint16_t first, uint16_t last, double tolerance, double *center)
+{
+  double *a = run.point[first];
+  double *m = run.point[(first+last)/2];
+  double *b = run.point[last];
+  uint16_t k;
+  uint8_t idx;
+  for (k=first+1; k<=last; k++) {
+    for (idx=0; idx<N_AXIS; idx++) {
+      if ((idx != X_AXIS) && (idx != Y_AXIS) && (run.point[k][idx] != a[idx])) { return(false); }
+    }
+  }
+  // 三点定圆
+  double bx = m[X_AXIS]-a[X_AXIS], by = m[Y_AXIS]-a[Y_AXIS];
+  double cx = b[X_AXIS]-a[X_AXIS], cy = b[Y_AXIS]-a[Y_AXIS];
+  double d = 2*(bx*cy-by*cx);
+  if (fabs(d) < 1e-12) { return(false); }
+  double ux = (cy*(bx*bx+by*by)-by*(cx*cx+cy*cy))/d;
+  double uy = (bx*(cx*cx+cy*cy)-cx*(bx*bx+by*by))/d;
+  double radius = hypot(ux, uy);
+  center[X_AXIS] = a[X_AXIS]+ux;
+  center[Y_AXIS] = a[Y_AXIS]+uy;
+
+  double sweep = 0;
+  double previous = atan2(a[Y_AXIS]-center[Y_AXIS], a[X_AXIS]-center[X_AXIS]);
+  for (k=first+1; k<=last; k++) {
+    double *p = run.point[k];
+    double *q = run.point[k-1];
+    if (fabs(hypot(p[X_AXIS]-center[X_AXIS], p[Y_AXIS]-center[Y_AXIS])-radius) > tolerance) { return(false); }
+    // 弦的中点在圆内，偏差就是弦高
+    double mx = 0.5*(p[X_AXIS]+q[X_AXIS]), my = 0.5*(p[Y_AXIS]+q[Y_AXIS]);
+    if (radius-hypot(mx-center[X_AXIS], my-center[Y_AXIS]) > tolerance) { return(false); }
+    double angle = atan2(p[Y_AXIS]-center[Y_AXIS], p[X_AXIS]-center[X_AXIS]);
+    double step = angle-previous;
+    if (step > M_PI) { step -= 2*M_PI; }
+    if (step <= -M_PI) { step += 2*M_PI; }
+    if ((step == 0) || (fabs(step) > M_PI/4) || ((sweep != 0) && ((step > 0) != (sweep > 0)))) { return(false); }
+    sweep += step;
+    previous = angle;
+  }
+  if (fabs(sweep) > 2*M_PI-0.1) { return(false); }
+
+  // 输出的I、J相对于舍入后的起点；检查舍入后的起点和终点半径，与gc_execute_line()的圆弧半径检查相同。
+  double start_radius = hypot(center[X_AXIS]-out.position[X_AXIS], center[Y_AXIS]-out.position[Y_AXIS]);
+  double end_radius = hypot(center[X_AXIS]-round_value(b[X_AXIS]), center[Y_AXIS]-round_value(b[Y_AXIS]));
+  double scale = (gc_state.modal.units == UNITS_MODE_INCHES) ? MM_PER_INCH : 1;
+  if (fabs(end_radius-start_radius)*scale > 0.25*0.005) { return(false); }
+  if (sweep > 0) { return(MOTION_MODE_CCW_ARC); }
+  return(MOTION_MODE_CW_ARC);
+}
+
+
+// 输出收集的折线。从每个点开始，贪心地选直线或圆弧中能代替更多点的一个。
+static void flush_run()
+{
+  if (run.count == 0) { return; }
+  double tolerance = config.tolerance;
+  if (gc_state.modal.units == UNITS_MODE_INCHES) { tolerance /= MM_PER_INCH; }
+  uint8_t arcs = config.arcs && (gc_state.modal.plane_select == PLANE_SELECT_XY);
+
+  uint16_t first = 0;
+  while (first < run.count) {
+    uint16_t line_end = first+1;
+    while ((line_end < run.count) && fit_line(first, line_end+1, tolerance)) { line_end++; }
+
+    uint16_t arc_end = 0;
+    uint8_t arc_motion = 0;
+    double center[N_AXIS];
+    if (arcs) {
+      double trial[N_AXIS];
+      uint16_t last;
+      for (last=first+4; last<=run.count; last++) {
+        uint8_t motion = fit_arc(first, last, tolerance, trial);
+        if (!motion) { break; }
+        arc_end = last;
+        arc_motion = motion;
+        memcpy(center, trial, sizeof(center));
+      }
+    }
+
+    if (arc_end > line_end) {
+      double ij[2] = { center[X_AXIS]-out.position[X_AXIS], center[Y_AXIS]-out.position[Y_AXIS] };
+      emit_motion(arc_motion, run.feed, run.point[arc_end], 0, ij);
+      stats.arcs++;
+      stats.arc_points += arc_end-first;
+      first = arc_end;
+    } else {
+      emit_motion(MOTION_MODE_LINEAR, run.feed, run.point[line_end], 0, NULL);
+      stats.merged += line_end-first-1;
+      first = line_end;
+    }
+  }
+  run.count = 0;
+}
+
+
+// 一行是否为简单的G0/G1。是则返回运动方式，并填写终点、进给和行中出现的坐标字，否则返回MOTION_MODE_NONE。
+static uint8_t parse_simple(char *line, double *target, char *feed, uint8_t *axis_words)
+{
+  if ((gc_state.modal.distance != DISTANCE_MODE_ABSOLUTE) || (gc_state.modal.feed_rate != FEED_RATE_MODE_UNITS_PER_MIN)) {
+    return(MOTION_MODE_NONE);
+  }
+  if (strlen(line) >= LINE_BUFFER_SIZE) { return(MOTION_MODE_NONE); }
+  const char *letters = "XYZGNF"; // 前N_AXIS个是坐标字
+  uint8_t motion = gc_state.modal.motion;
+  uint8_t words = 0;
+  uint8_t char_counter = 0;
+  float value;
+  program_position(target);
+  current_feed(feed);
+  while (line[char_counter] != 0) {
+    const char *found = strchr(letters, line[char_counter++]);
+    if ((found == NULL) || !read_float(line, &char_counter, &value)) { return(MOTION_MODE_NONE); }
+    uint8_t idx = found-letters;
+    if (bit_istrue(words, bit(idx))) { return(MOTION_MODE_NONE); }
+    words |= bit(idx);
+    switch (*found) {
+      case 'G':
+        if ((value != 0) && (value != 1)) { return(MOTION_MODE_NONE); }
+        motion = (uint8_t)value;
+        break;
+      case 'N': break;
+      case 'F': format_number(feed, value, gcopt_decimals()); break;
+      default: target[idx] = value;
+    }
+  }
+  if ((motion != MOTION_MODE_SEEK) && (motion != MOTION_MODE_LINEAR)) { return(MOTION_MODE_NONE); }
+  *axis_words = words & GCOPT_ALL_AXES;
+  return(motion);
+}
+
+
+#define SCAN_AXIS 0    // 有坐标字
+#define SCAN_MOTION 1  // 有运动方式（G0~G3、G38.x、G80）
+#define SCAN_FEED 2    // 有F字
+
+// 找出一行中与运动模态和进给有关的字
+static uint8_t scan_words(char *line)
+{
+  const char *axes = "XYZABC";
+  uint8_t words = 0;
+  uint8_t char_counter = 0;
+  float value;
+  while (line[char_counter] != 0) {
+    char letter = line[char_counter++];
+    if (!read_float(line, &char_counter, &value)) { break; }
+    const char *axis = strchr(axes, letter);
+    if (axis && (axis-axes < N_AXIS)) { words |= bit(SCAN_AXIS); }
+    if (letter == 'F') { words |= bit(SCAN_FEED); }
+    if ((letter == 'G') && ((value < 4) || (trunc(value) == 38) || (value == 80))) { words |= bit(SCAN_MOTION); }
+  }
+  return(words);
+}
+
+
+static void optimize_line(char *line)
+{
+  replay_normalize(line);
+  if (line[0] == 0) { return; }
+  if (line[0] == '$') {
+    flush_run();
+    emit(line);
+    emit("\n");
+    out.known = 0;
+    return;
+  }
+
+  double target[N_AXIS];
+  char feed[24], pre_feed[24];
+  uint8_t axis_words = 0;
+  uint8_t pre_motion = gc_state.modal.motion;
+  uint8_t pre_units = gc_state.modal.units;
+  current_feed(pre_feed);
+  uint8_t motion = parse_simple(line, target, feed, &axis_words);
+  // 这一行不能接在收集的折线后面时，先在执行它之前输出折线。拟合和输出用的单位、平面等模态必须是折线执行时的，
+  // 否则折线后面的G20或G18会改变圆弧拟合和坐标的格式。
+  uint8_t extend = (motion == MOTION_MODE_LINEAR) && (out.known == GCOPT_ALL_AXES);
+  if ((run.count > 0) && (strcmp(feed, run.feed) || (run.count == GCOPT_MAX_RUN))) { extend = false; }
+  if (!extend) { flush_run(); }
+  uint8_t status = replay_line(line);
+  if ((motion != MOTION_MODE_NONE) && (status == STATUS_OK)) {
+    if (extend) {
+      if (run.count == 0) {
+        memcpy(run.point[0], out.position, sizeof(run.point[0]));
+        strcpy(run.feed, feed);
+      }
+      if (distance(target, run.point[run.count]) == 0) { stats.dropped++; }
+      else { memcpy(run.point[++run.count], target, sizeof(run.point[0])); }
+    } else {
+      // G0和位置未知时的G1不合并，只去掉多余的字。
+      emit_motion(motion, feed, target, axis_words, NULL);
+    }
+    return;
+  }
+
+  // 其它行原样输出，出错的行也一样，机器上会得到同样的错误。输出的运动模态和进给可能因为合并、拟合圆弧或去掉多余的字
+  // 而与输入不同，这一行有坐标字却没有写运动方式或进给时，先补上输入中执行前的值。这时输入的运动模态一定是G0或G1。
+  flush_run(); //出错的G1行没有在上面输出折线，错误不改变模态。
+  uint8_t words = scan_words(line);
+  char word[32];
+  word[0] = 0;
+  uint8_t sync_motion = bit_istrue(words, bit(SCAN_AXIS)) && bit_isfalse(words, bit(SCAN_MOTION)) && (pre_motion != out.motion);
+  uint8_t sync_feed = bit_istrue(words, bit(SCAN_AXIS)) && bit_isfalse(words, bit(SCAN_FEED)) && strcmp(pre_feed, out.feed) && strcmp(pre_feed, "0");
+  if (sync_motion) { sprintf(word, "G%d", pre_motion); }
+  if (sync_feed) { sprintf(word+strlen(word), "F%s", pre_feed); }
+  if (word[0]) {
+    emit(word);
+    emit("\n");
+  }
+  emit(line);
+  emit("\n");
+  if (status == STATUS_OK) {
+    // 解析器与机器对已知的轴看法一致，执行之后仍然一致。
+    double position[N_AXIS];
+    uint8_t idx;
+    program_position(position);
+    for (idx=0; idx<N_AXIS; idx++) { out.position[idx] = round_value(position[idx]); }
+    if (sync_motion || bit_istrue(words, bit(SCAN_MOTION)) || (gc_state.modal.motion != pre_motion)) { out.motion = gc_state.modal.motion; }
+    if (sync_feed || bit_istrue(words, bit(SCAN_FEED)) || !strcmp(pre_feed, out.feed)) { current_feed(out.feed); }
+    else if (gc_state.modal.units != pre_units) { out.feed[0] = 0; } // 单位改变后输出的进给无法按新单位表示
+  } else {
+    if (sync_motion) { out.motion = pre_motion; }
+    if (sync_feed) { strcpy(out.feed, pre_feed); }
+  }
+}
+
+
+static void usage(const char *name)
+{
+  fprintf(stderr,
+    "usage: %s [-t tolerance] [-d decimals] [-a] [-e eeprom] [-o output] input.nc\n"
+    "  -t  allowed deviation in mm when merging lines and fitting arcs (default 0.005)\n"
+    "  -d  decimals written in mm mode, one more in inch mode (default 4)\n"
+    "  -a  do not fit arcs, only merge collinear lines\n"
+    "  -e  load $ settings from an EEPROM file saved by the simulator\n"
+    "  -o  write the optimized program here instead of stdout\n",
+    name);
+  exit(1);
+}
+
+
+static char *read_file(const char *name, size_t *size)
+{
+  FILE *fp = fopen(name, "rb");
+  if (fp == NULL) { perror(name); exit(1); }
+  char *data = NULL;
+  size_t len = 0, capacity = 0, n;
+  do {
+    if (len+65536 > capacity) {
+      capacity = (len+65536)*2;
+      data = realloc(data, capacity+1);
+      if (data == NULL) { perror("gcopt"); exit(1); }
+    }
+    n = fread(data+len, 1, capacity-len, fp);
+    len += n;
+  } while (n > 0);
+  fclose(fp);
+  data[len] = 0;
+  *size = len;
+  return(data);
+}
+
+
+// 逐行处理文本，每行复制到可写的缓冲区中。
+static void for_each_line(const char *text, void (*process)(char *line))
+{
+  static char line[1024];
+  while (*text) {
+    size_t len = strcspn(text, "\n");
+    size_t copy = min(len, sizeof(line)-1);
+    memcpy(line, text, copy);
+    line[copy] = 0;
+    process(line);
+    text += len;
+    if (*text) { text++; }
+  }
+}
+
+
+static void replay_process(char *line)
+{
+  replay_normalize(line);
+  replay_line(line);
+}
+
+
+// 不在检查模式下重放一个程序，得到块数和加工时间。position返回结束时解析器的位置（mm）。
+static replay_result_t replay_program(const char *text, float *position)
+{
+  replay_start(false);
+  for_each_line(text, replay_process);
+  replay_finish();
+  memcpy(position, gc_state.position, sizeof(gc_state.position));
+  return(replay_result);
+}
+
+
+static void print_result(const char *name, uint32_t lines, size_t bytes, replay_result_t *result)
+{
+  fprintf(stderr, "%-7s %8u %10zu %8u %7u %10.3f\n", name, lines, bytes, result->blocks, result->errors,
+          (double)result->cycles/F_CPU);
+}
+
+
+static uint32_t count_lines(const char *text)
+{
+  uint32_t lines = 0;
+  for (; *text; text++) {
+    if (*text == '\n') { lines++; }
+  }
+  return(lines);
+}
+
+
+int main(int argc, char *argv[])
+{
+  const char *eeprom_file = NULL;
+  const char *output_file = NULL;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "t:d:ae:o:h")) != -1) {
+    switch (opt) {
+      case 't': config.tolerance = atof(optarg); break;
+      case 'd': config.decimals = atoi(optarg); break;
+      case 'a': config.arcs = false; break;
+      case 'e': eeprom_file = optarg; break;
+      case 'o': output_file = optarg; break;
+      default: usage(argv[0]);
+    }
+  }
+  if ((optind != argc-1) || (config.tolerance < 0) || (config.decimals < 0) || (config.decimals > 6)) { usage(argv[0]); }
+
+  size_t input_size;
+  char *input = read_file(argv[optind], &input_size);
+  replay_init(eeprom_file);
+
+  // 检查模式下逐行解析并改写
+  replay_start(true);
+  out.motion = gc_state.modal.motion;
+  current_feed(out.feed);
+  for_each_line(input, optimize_line);
+  flush_run();
+  replay_finish();
+  if (output == NULL) { emit(""); }
+
+  FILE *fp = stdout;
+  if (output_file) {
+    fp = fopen(output_file, "w");
+    if (fp == NULL) { perror(output_file); exit(1); }
+  }
+  fwrite(output, 1, output_len, fp);
+  if (fp != stdout) { fclose(fp); }
+
+  // 重放输入和输出，比较块数、加工时间和终点
+  float input_position[N_AXIS], output_position[N_AXIS];
+  replay_result_t input_result = replay_program(input, input_position);
+  replay_result_t output_result = replay_program(output, output_position);
+  double deviation = 0;
+  uint8_t idx;
+  for (idx=0; idx<N_AXIS; idx++) { deviation = max(deviation, fabs(input_position[idx]-output_position[idx])); }
+
+  fprintf(stderr, "%-7s %8s %10s %8s %7s %10s\n", "", "lines", "bytes", "blocks", "errors", "time_s");
+  print_result("input", count_lines(input), input_size, &input_result);
+  print_result("output", count_lines(output), output_len, &output_result);
+  fprintf(stderr, "merged %u lines, fitted %u arcs from %u lines, dropped %u lines, end point difference %.4f mm\n",
+          stats.merged, stats.arcs, stats.arc_points, stats.dropped, deviation);
+  return(0);
+}
@@ -0,0 +1,25 @@
+/*
+  avr/interrupt.h - 主机仿真用的中断宏替身
+  Grbl仿真的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+#ifndef sim_avr_interrupt_h
+#define sim_avr_interrupt_h
+
+#include "avr/io.h"
+
+// 中断服务程序被编译成普通函数，函数名就是中断向量名，由sim.c在虚拟时间到达时调用。
+#define ISR(vector, ...) void vector(void)
+
+void sim_sei(void);
+void sim_cli(void);
+#define sei() sim_sei()
+#define cli() sim_cli()
+
+#endif
@@ -0,0 +1,131 @@
+/*
+  avr/io.h - 主机仿真用的ATmega328p寄存器替身
+  Grbl仿真的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+// 所有寄存器都只是普通的全局变量（定义在io.c中），由仿真器在虚拟时钟推进时轮询。
+// 寄存器本身没有副作用，定时器/串口/中断的行为全部由sim.c根据这些变量的值来模拟。
+
+#ifndef sim_avr_io_h
+#define sim_avr_io_h
+
+#include <stdint.h>
+
+// 状态寄存器，只用到第7位（全局中断使能）
+extern volatile uint8_t SREG;
+#define SREG_I 7
+
+// IO端口
+extern volatile uint8_t PORTB, PORTC, PORTD;
+extern volatile uint8_t PINB, PINC, PIND;
+extern volatile uint8_t DDRB, DDRC, DDRD;
+
+// 定时器0
+extern volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B, TIMSK0, TIFR0;
+// 定时器1
+extern volatile uint8_t TCCR1A, TCCR1B, TCCR1C, TIMSK1, TIFR1;
+extern volatile uint16_t TCNT1, OCR1A, OCR1B;
+// 定时器2
+extern volatile uint8_t TCCR2A, TCCR2B, TCNT2, OCR2A, OCR2B, TIMSK2, TIFR2;
+
+// 串口0
+extern volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UBRR0H, UBRR0L, UDR0;
+
+// EEPROM（eeprom.c已由仿真版本替换，这里只为了编译通过）
+extern volatile uint8_t EECR, EEDR, SPMCSR;
+extern volatile uint16_t EEAR;
+
+// 引脚变化中断、看门狗、复位状态
+extern volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2;
+extern volatile uint8_t WDTCSR, MCUSR;
+
+// 定时器位定义
+#define CS00 0
+#define CS01 1
+#define CS02 2
+#define WGM00 0
+#define WGM01 1
+#define WGM02 3
+#define COM0A0 6
+#define COM0A1 7
+#define TOIE0 0
+#define OCIE0A 1
+#define OCIE0B 2
+#define TOV0 0
+
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM10 0
+#define WGM11 1
+#define WGM12 3
+#define WGM13 4
+#define COM1B0 4
+#define COM1B1 5
+#define COM1A0 6
+#define COM1A1 7
+#define TOIE1 0
+#define OCIE1A 1
+#define OCIE1B 2
+
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define WGM20 0
+#define WGM21 1
+#define WGM22 3
+#define COM2B0 4
+#define COM2B1 5
+#define COM2A0 6
+#define COM2A1 7
+#define TOIE2 0
+#define OCIE2A 1
+
+// 串口位定义
+#define MPCM0 0
+#define U2X0 1
+#define UDRE0 5
+#define TXC0 6
+#define RXC0 7
+#define TXB80 0
+#define RXB80 1
+#define UCSZ02 2
+#define TXEN0 3
+#define RXEN0 4
+#define UDRIE0 5
+#define TXCIE0 6
+#define RXCIE0 7
+
+// EEPROM位定义
+#define EERE 0
+#define EEPE 1
+#define EEMPE 2
+#define EERIE 3
+#define EEPM0 4
+#define EEPM1 5
+#define SELFPRGEN 0
+
+// 引脚变化中断位定义
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+
+// 看门狗位定义
+#define WDP0 0
+#define WDP1 1
+#define WDP2 2
+#define WDE 3
+#define WDCE 4
+#define WDP3 5
+#define WDIE 6
+#define WDIF 7
+
+#define E2END 0x3FF
+
+#endif
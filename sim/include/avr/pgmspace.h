@@ -0,0 +1,25 @@
+/*
+  avr/pgmspace.h - 主机仿真用的程序存储器访问替身
+  Grbl仿真的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+#ifndef sim_avr_pgmspace_h
+#define sim_avr_pgmspace_h
+
+#include <stdint.h>
+
+// 主机上没有独立的程序存储器，全部退化为普通内存访问。
+#define __flash
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte_near(addr) (*(const uint8_t *)(addr))
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_float(addr) (*(const float *)(addr))
+
+#endif
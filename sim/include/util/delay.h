@@ -0,0 +1,22 @@
+/*
+  util/delay.h - 主机仿真用的延时替身
+  Grbl仿真的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+#ifndef sim_util_delay_h
+#define sim_util_delay_h
+
+#include <stdint.h>
+
+// 延时不消耗真实时间，只推进虚拟时钟（期间照常触发到期的中断）。
+void sim_delay_cycles(uint32_t cycles);
+#define _delay_ms(ms) sim_delay_cycles((uint32_t)((F_CPU/1000UL)*(ms)))
+#define _delay_us(us) sim_delay_cycles((uint32_t)((F_CPU/1000000UL)*(us)))
+
+#endif
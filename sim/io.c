@@ -0,0 +1,27 @@
+/*
+  io.c - 主机仿真用的ATmega328p寄存器
+  Grbl仿真的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+#include <avr/io.h>
+
+// ATmega328p寄存器
+volatile uint8_t SREG = (1<<SREG_I); // EEPROM为空时settings_init()在sei()之前输出全部设置，这里先打开中断以免发送缓冲区卡死
+volatile uint8_t PORTB, PORTC, PORTD;
+volatile uint8_t PINB = 0xff, PINC = 0xff, PIND = 0xff; // 上拉输入，开关全部断开
+volatile uint8_t DDRB, DDRC, DDRD;
+volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B, TIMSK0, TIFR0;
+volatile uint8_t TCCR1A, TCCR1B, TCCR1C, TIMSK1, TIFR1;
+volatile uint16_t TCNT1, OCR1A, OCR1B;
+volatile uint8_t TCCR2A, TCCR2B, TCNT2, OCR2A, OCR2B, TIMSK2, TIFR2;
+volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UBRR0H, UBRR0L, UDR0;
+volatile uint8_t EECR, EEDR, SPMCSR;
+volatile uint16_t EEAR;
+volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2;
+volatile uint8_t WDTCSR, MCUSR;
@@ -0,0 +1,71 @@
+/*
+  main.c - 主机仿真入口
+  Grbl仿真的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+// grbl/main.c 的 main() 在编译时被改名为 grbl_main()（-Dmain=grbl_main），这里恢复真正的入口。
+#undef main
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "sim.h"
+
+int grbl_main(void);
+
+
+static void usage(const char *name)
+{
+  fprintf(stderr,
+    "usage: %s [-t trace] [-s] [-c cycles] [-b baud] [-l seconds] [-e eeprom] [-q] [file.gcode]\n"
+    "  -t  write timestamped step/direction trace to file\n"
+    "  -s  add segment and block boundaries to the trace\n"
+    "  -c  virtual CPU cycles per firmware function call (default %u)\n"
+    "  -b  serial baud rate (default %u)\n"
+    "  -l  stop after this many virtual seconds\n"
+    "  -e  load/save EEPROM image from/to file\n"
+    "  -q  do not echo Grbl output\n",
+    name, sim_config.cycles_per_call, sim_config.baud);
+  exit(1);
+}
+
+
+int main(int argc, char *argv[])
+{
+  const char *eeprom_file = NULL;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "t:sc:b:l:e:qh")) != -1) {
+    switch (opt) {
+      case 't':
+        sim_config.trace = fopen(optarg, "w");
+        if (sim_config.trace == NULL) { perror(optarg); exit(1); }
+        break;
+      case 's': sim_config.trace_segments = 1; break;
+      case 'c': sim_config.cycles_per_call = strtoul(optarg, NULL, 0); break;
+      case 'b': sim_config.baud = strtoul(optarg, NULL, 0); break;
+      case 'l': sim_config.time_limit = atof(optarg); break;
+      case 'e': eeprom_file = optarg; break;
+      case 'q': sim_config.echo = 0; break;
+      default: usage(argv[0]);
+    }
+  }
+  if ((sim_config.cycles_per_call == 0) || (sim_config.baud == 0)) { usage(argv[0]); }
+
+  if (optind < argc) {
+    sim_config.gcode = fopen(argv[optind], "r");
+    if (sim_config.gcode == NULL) { perror(argv[optind]); exit(1); }
+  } else {
+    sim_config.gcode = stdin;
+  }
+
+  sim_eeprom_init(eeprom_file);
+  sim_start();
+  return grbl_main();
+}
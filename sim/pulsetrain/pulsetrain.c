@@ -0,0 +1,358 @@
+/*
+  pulsetrain.c - 步进脉冲序列分析：按段和块统计各轴步进间隔抖动、速度波动和方向建立时间
+  Grbl仿真的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+/*
+  读取grbl-sim -t trace -s输出的跟踪。一个段内步进中断的周期不变，最长的轴每2^AMASS级别个中断走一步，
+  其他轴的理想步进间隔是最长轴的间隔乘以块内两轴的步数比。块结束后才知道各轴的步数，所以按块缓存段内的间隔：
+    抖动：段内相邻两步的间隔与理想间隔之差（微秒）。跨段的间隔含有加减速，不计入。
+    速度波动：瞬时速率（间隔的倒数）与理想速率之差的最大值，占理想速率的百分比。
+    方向建立时间：方向改变到该轴下一个步进脉冲上升沿的时间，小于$0（或-p）时算作一次违例。
+  另外统计脉冲宽度（上升沿到下降沿）和两个脉冲之间的最短低电平时间。
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+
+#define MAX_AXES 8
+#define AXIS_NAMES "XYZABCUV"
+
+
+// 一组间隔的统计。段、块和整个跟踪各用一份。
+typedef struct {
+  uint32_t steps;
+  uint32_t intervals;     // 计入抖动的间隔数（段内）
+  double jitter_max;      // us
+  double jitter_sum_sq;   // us^2，除以intervals开方为均方根
+  double ripple_max;      // %
+} stats_t;
+
+// 块内的一个段
+typedef struct {
+  uint32_t number;        // 段序号
+  uint32_t ticks;         // 步进中断数
+  uint32_t period;        // 中断周期（CPU周期）
+  uint8_t level;          // AMASS级别
+  stats_t axis[MAX_AXES];
+} segment_t;
+
+// 块内一个轴的段内步进间隔
+typedef struct {
+  uint64_t cycles;
+  uint32_t segment;       // 块内的段下标
+} interval_t;
+
+typedef struct {
+  interval_t *interval;
+  uint32_t n_interval, size;
+  uint64_t last_rise;       // 上一个上升沿的时刻
+  uint32_t last_rise_segment;
+  uint8_t has_rise;
+  uint64_t fall;            // 上一个下降沿的时刻
+  uint8_t has_fall;
+  uint64_t dir_change;      // 方向改变的时刻，下一步之前有效
+  uint8_t dir_pending;
+
+  stats_t block, total;
+  uint32_t dir_changes;
+  uint32_t setup_violations;
+  uint32_t block_setup_violations;
+  double setup_min;         // us，方向改变后第一步的最短建立时间
+  double width_min;         // us，最短脉冲宽度
+  double low_min;           // us，两个脉冲之间最短的低电平时间
+} axis_t;
+
+static struct {
+  double f_cpu;
+  int axes;
+  double pulse_us;          // 方向建立时间的下限
+  uint8_t pulse_override;   // 由-p给出，忽略跟踪中的$0
+  uint8_t print_segments;
+  uint8_t print_blocks;
+
+  uint8_t step_bits, dir_bits;
+  axis_t axis[MAX_AXES];
+
+  segment_t *segment;       // 当前块的段
+  uint32_t n_segment, size;
+  uint32_t segments;        // 段总数，也是最后一段的序号
+  uint32_t block;           // 当前块的序号
+  uint32_t blocks;
+  uint64_t block_start;
+  uint64_t last_time;
+} trace = { .f_cpu = 16000000.0, .axes = 3, .pulse_us = 10.0, .print_blocks = 1 };
+
+
+static double us(double cycles) { return(cycles*1000000.0/trace.f_cpu); }
+
+
+static void *grow(void *buffer, uint32_t *size, size_t item)
+{
+  *size = *size ? 2*(*size) : 256;
+  buffer = realloc(buffer, (*size)*item);
+  if (buffer == NULL) { perror("realloc"); exit(1); }
+  return(buffer);
+}
+
+
+static void stats_add(stats_t *to, const stats_t *from)
+{
+  to->steps += from->steps;
+  to->intervals += from->intervals;
+  to->jitter_sum_sq += from->jitter_sum_sq;
+  if (from->jitter_max > to->jitter_max) { to->jitter_max = from->jitter_max; }
+  if (from->ripple_max > to->ripple_max) { to->ripple_max = from->ripple_max; }
+}
+
+
+static double stats_rms(const stats_t *stats)
+{
+  return(stats->intervals ? sqrt(stats->jitter_sum_sq/stats->intervals) : 0.0);
+}
+
+
+static void print_axis_stats(const stats_t *stats)
+{
+  if (stats->steps) { printf(" %7u %8.2f %8.2f %7.1f", stats->steps, stats->jitter_max, stats_rms(stats), stats->ripple_max); }
+  else { printf(" %7s %8s %8s %7s", "-", "-", "-", "-"); }
+}
+
+
+static void print_header(const char *first, const char *last)
+{
+  printf("%s", first);
+  int idx;
+  for (idx=0; idx<trace.axes; idx++) {
+    printf(" %6c_steps %4c_max %4c_rms %3c_ripl", AXIS_NAMES[idx], AXIS_NAMES[idx], AXIS_NAMES[idx], AXIS_NAMES[idx]);
+  }
+  printf("%s\n", last);
+}
+
+
+// 块结束：按块内各轴的步数比计算理想间隔，统计每个段和整个块。
+static void block_finish()
+{
+  if (trace.n_segment == 0) { return; }
+  int idx;
+  uint32_t i;
+  uint32_t events = 0; // 最长轴的步数
+  for (idx=0; idx<trace.axes; idx++) {
+    axis_t *axis = &trace.axis[idx];
+    axis->block.steps = 0;
+    for (i=0; i<trace.n_segment; i++) { axis->block.steps += trace.segment[i].axis[idx].steps; }
+    if (axis->block.steps > events) { events = axis->block.steps; }
+  }
+
+  for (idx=0; idx<trace.axes; idx++) {
+    axis_t *axis = &trace.axis[idx];
+    for (i=0; i<axis->n_interval; i++) {
+      segment_t *segment = &trace.segment[axis->interval[i].segment];
+      stats_t *stats = &segment->axis[idx];
+      double ideal = (double)((uint64_t)segment->period << segment->level)*events/axis->block.steps;
+      double error = fabs(us(axis->interval[i].cycles) - us(ideal));
+      double ripple = 100.0*fabs(ideal/axis->interval[i].cycles - 1.0);
+      stats->intervals++;
+      stats->jitter_sum_sq += error*error;
+      if (error > stats->jitter_max) { stats->jitter_max = error; }
+      if (ripple > stats->ripple_max) { stats->ripple_max = ripple; }
+    }
+    axis->n_interval = 0;
+    axis->block.steps = 0;
+  }
+
+  for (i=0; i<trace.n_segment; i++) {
+    segment_t *segment = &trace.segment[i];
+    if (trace.print_segments) {
+      printf("seg %9u %7u %6u %9.2f %3u", segment->number, trace.block, segment->ticks, us(segment->period), segment->level);
+      for (idx=0; idx<trace.axes; idx++) { print_axis_stats(&segment->axis[idx]); }
+      printf("\n");
+    }
+    for (idx=0; idx<trace.axes; idx++) { stats_add(&trace.axis[idx].block, &segment->axis[idx]); }
+  }
+
+  uint32_t violations = 0;
+  for (idx=0; idx<trace.axes; idx++) { violations += trace.axis[idx].block_setup_violations; }
+  if (trace.print_blocks) {
+    printf("block %7u %8u %10.3f", trace.block, trace.n_segment, us(trace.last_time-trace.block_start)/1000.0);
+    for (idx=0; idx<trace.axes; idx++) { print_axis_stats(&trace.axis[idx].block); }
+    printf(" %9u\n", violations);
+  }
+  for (idx=0; idx<trace.axes; idx++) {
+    axis_t *axis = &trace.axis[idx];
+    stats_add(&axis->total, &axis->block);
+    memset(&axis->block, 0, sizeof(stats_t));
+    axis->block_setup_violations = 0;
+  }
+  trace.n_segment = 0;
+}
+
+
+static void segment_begin(uint64_t time, uint32_t block, uint32_t ticks, uint32_t period, uint8_t level)
+{
+  if (block != trace.block) {
+    block_finish();
+    trace.block = block;
+    trace.block_start = time;
+    trace.blocks++;
+  }
+  if (trace.n_segment == trace.size) { trace.segment = grow(trace.segment, &trace.size, sizeof(segment_t)); }
+  segment_t *segment = &trace.segment[trace.n_segment++];
+  memset(segment, 0, sizeof(segment_t));
+  segment->number = ++trace.segments;
+  segment->ticks = ticks;
+  segment->period = period;
+  segment->level = level;
+}
+
+
+static void port_change(uint64_t time, uint8_t step_bits, uint8_t dir_bits)
+{
+  int idx;
+  for (idx=0; idx<trace.axes; idx++) {
+    axis_t *axis = &trace.axis[idx];
+    uint8_t mask = 1 << idx;
+    if ((dir_bits ^ trace.dir_bits) & mask) {
+      axis->dir_changes++;
+      axis->dir_change = time;
+      axis->dir_pending = 1;
+    }
+    if ((step_bits & mask) && !(trace.step_bits & mask)) {
+      if (axis->dir_pending) {
+        double setup = us(time-axis->dir_change);
+        if (setup < axis->setup_min) { axis->setup_min = setup; }
+        if (setup < trace.pulse_us) {
+          axis->setup_violations++;
+          axis->block_setup_violations++;
+        }
+        axis->dir_pending = 0;
+      }
+      if (axis->has_fall) {
+        double low = us(time-axis->fall);
+        if (low < axis->low_min) { axis->low_min = low; }
+      }
+      if (trace.n_segment) {
+        // 第一个段之前的步（没有段边界）不计入统计
+        if (axis->has_rise && (axis->last_rise_segment == trace.segments)) {
+          if (axis->n_interval == axis->size) { axis->interval = grow(axis->interval, &axis->size, sizeof(interval_t)); }
+          axis->interval[axis->n_interval].cycles = time-axis->last_rise;
+          axis->interval[axis->n_interval].segment = trace.n_segment-1;
+          axis->n_interval++;
+        }
+        trace.segment[trace.n_segment-1].axis[idx].steps++;
+      }
+      axis->last_rise = time;
+      axis->last_rise_segment = trace.segments;
+      axis->has_rise = 1;
+    }
+    if (!(step_bits & mask) && (trace.step_bits & mask)) {
+      double width = us(time-axis->last_rise);
+      if (width < axis->width_min) { axis->width_min = width; }
+      axis->fall = time;
+      axis->has_fall = 1;
+    }
+  }
+  trace.step_bits = step_bits;
+  trace.dir_bits = dir_bits;
+}
+
+
+static void usage(const char *name)
+{
+  fprintf(stderr,
+    "usage: %s [-S] [-q] [-p us] trace\n"
+    "  trace is written by grbl-sim -t trace -s\n"
+    "  -S  print every segment\n"
+    "  -q  print only the per-axis totals\n"
+    "  -p  minimum direction setup time in us (default: $0 from the trace)\n",
+    name);
+  exit(1);
+}
+
+
+int main(int argc, char *argv[])
+{
+  int opt;
+  while ((opt = getopt(argc, argv, "Sqp:h")) != -1) {
+    switch (opt) {
+      case 'S': trace.print_segments = 1; break;
+      case 'q': trace.print_blocks = 0; trace.print_segments = 0; break;
+      case 'p': trace.pulse_us = atof(optarg); trace.pulse_override = 1; break;
+      default: usage(argv[0]);
+    }
+  }
+  if (optind != argc-1) { usage(argv[0]); }
+  FILE *file = fopen(argv[optind], "r");
+  if (file == NULL) { perror(argv[optind]); return(1); }
+
+  int idx;
+  for (idx=0; idx<MAX_AXES; idx++) {
+    trace.axis[idx].setup_min = INFINITY;
+    trace.axis[idx].width_min = INFINITY;
+    trace.axis[idx].low_min = INFINITY;
+  }
+
+  char line[256];
+  uint32_t line_number = 0;
+  uint8_t header = 0;
+  while (fgets(line, sizeof(line), file)) {
+    line_number++;
+    unsigned long long time;
+    unsigned int block, ticks, period, level, step_bits, dir_bits;
+    if (line[0] == '#') {
+      char *field;
+      if ((field = strstr(line, "f_cpu="))) { trace.f_cpu = atof(field+6); }
+      if ((field = strstr(line, "axes="))) {
+        trace.axes = atoi(field+5);
+        if ((trace.axes < 1) || (trace.axes > MAX_AXES)) { fprintf(stderr, "%s: bad axis count\n", argv[optind]); return(1); }
+      }
+      if ((field = strstr(line, "pulse_us=")) && !trace.pulse_override) { trace.pulse_us = atof(field+9); }
+      if (!header) {
+        // 轴数在第一行给出
+        if (trace.print_segments) { print_header("seg   segment   block  ticks period_us lvl", ""); }
+        if (trace.print_blocks) { print_header("block   block segments    time_ms", " setup_err"); }
+        header = 1;
+      }
+    } else if (sscanf(line, "s %llu %u %u %u %u", &time, &block, &ticks, &period, &level) == 5) {
+      segment_begin(time, block, ticks, period, level);
+      trace.last_time = time;
+    } else if (sscanf(line, "%llu %x %x", &time, &step_bits, &dir_bits) == 3) {
+      port_change(time, step_bits, dir_bits);
+      trace.last_time = time;
+    } else {
+      fprintf(stderr, "%s:%u: unrecognized line\n", argv[optind], line_number);
+      return(1);
+    }
+  }
+  fclose(file);
+  if (trace.segments == 0) {
+    fprintf(stderr, "%s: no segment boundaries, run grbl-sim with -s\n", argv[optind]);
+    return(1);
+  }
+  block_finish();
+
+  // 整个跟踪的各轴统计
+  printf("pulsetrain %u blocks, %u segments, %.6f s, direction setup limit %.1f us\n",
+    trace.blocks, trace.segments, us(trace.last_time)/1000000.0, trace.pulse_us);
+  printf("axis    steps jitter_max_us jitter_rms_us ripple_max_%% dir_changes setup_err setup_min_us width_min_us low_min_us\n");
+  for (idx=0; idx<trace.axes; idx++) {
+    axis_t *axis = &trace.axis[idx];
+    printf("%c    %8u %13.2f %13.2f %12.1f %11u %9u %12.2f %12.2f %10.2f\n", AXIS_NAMES[idx],
+      axis->total.steps, axis->total.jitter_max, stats_rms(&axis->total), axis->total.ripple_max,
+      axis->dir_changes, axis->setup_violations,
+      isinf(axis->setup_min) ? 0.0 : axis->setup_min,
+      isinf(axis->width_min) ? 0.0 : axis->width_min,
+      isinf(axis->low_min) ? 0.0 : axis->low_min);
+  }
+  return(0);
+}
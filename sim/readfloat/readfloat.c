@@ -0,0 +1,253 @@
+/*
+  readfloat.c - read_float()的模糊测试和基准测试：与原来的实现比较语法、精度和耗时
+  Grbl仿真的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+/*
+  三项检查：
+    fuzz      随机字符串（数字、小数点、符号和其它字母），两种实现的返回值和char_counter必须相同。
+              不超过7位数字时新的结果必须与strtod()相同，8位时相差不超过1个最低位（更多的数字两种实现都丢弃）。
+    accuracy  G代码中常见的定点数（0~4位小数，以及7、8位有效数字），与strtod()正确舍入的结果比较，
+              统计不是正确舍入的比例和最大误差（最低位个数）。
+    speed     同一组定点数，每次调用的主机耗时。
+
+  原来的实现复制在下面作为参照。AVR上double就是float，所以其中的0.01、0.1、10.0写成float常数，
+  与单片机上的舍入相同。主机有浮点硬件，耗时只适合比较两种实现，不能代表AVR上的周期数。
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "grbl.h"
+
+#define FUZZ_COUNT 2000000
+#define ACCURACY_COUNT 1000000
+#define SPEED_COUNT 200000
+#define SPEED_RUNS 20
+
+// nuts_bolts.c中其它函数需要的替身
+system_t sys;
+void protocol_execute_realtime() { }
+void protocol_exec_rt_system() { }
+void sim_delay_cycles(uint32_t cycles) { }
+
+
+// Grbl 1.1h的read_float()
+static uint8_t read_float_original(char *line, uint8_t *char_counter, float *float_ptr)
+{
+  char *ptr = line + *char_counter;
+  unsigned char c;
+
+  c = *ptr++;
+
+  bool isnegative = false;
+  if (c == '-') {
+    isnegative = true;
+    c = *ptr++;
+  } else if (c == '+') {
+    c = *ptr++;
+  }
+
+  uint32_t intval = 0;
+  int8_t exp = 0;
+  uint8_t ndigit = 0;
+  bool isdecimal = false;
+  while(1) {
+    c -= '0';
+    if (c <= 9) {
+      ndigit++;
+      if (ndigit <= MAX_INT_DIGITS) {
+        if (isdecimal) { exp--; }
+        intval = (((intval << 2) + intval) << 1) + c; // intval*10 + c
+      } else {
+        if (!(isdecimal)) { exp++; }  //丢弃溢出数字
+      }
+    } else if (c == (('.'-'0') & 0xff)  &&  !(isdecimal)) {
+      isdecimal = true;
+    } else {
+      break;
+    }
+    c = *ptr++;
+  }
+
+  if (!ndigit) { return(false); };
+
+  float fval;
+  fval = (float)intval;
+
+  if (fval != 0) {
+    while (exp <= -2) {
+      fval *= 0.01f;
+      exp += 2;
+    }
+    if (exp < 0) {
+      fval *= 0.1f;
+    } else if (exp > 0) {
+      do {
+        fval *= 10.0f;
+      } while (--exp > 0);
+    }
+  }
+
+  if (isnegative) {
+    *float_ptr = -fval;
+  } else {
+    *float_ptr = fval;
+  }
+
+  *char_counter = ptr - line - 1;
+
+  return(true);
+}
+
+
+typedef uint8_t (*read_float_t)(char *line, uint8_t *char_counter, float *float_ptr);
+
+static uint32_t random_state = 1;
+
+static uint32_t random_next()
+{
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return(random_state);
+}
+
+
+// 两个float之间相差的最低位个数
+static uint32_t ulp_distance(float a, float b)
+{
+  int32_t ia, ib;
+  memcpy(&ia, &a, sizeof(ia));
+  memcpy(&ib, &b, sizeof(ib));
+  if (ia < 0) { ia = INT32_MIN - ia; }
+  if (ib < 0) { ib = INT32_MIN - ib; }
+  return(ia > ib ? (uint32_t)ia - ib : (uint32_t)ib - ia);
+}
+
+
+// G代码中的定点数：1~4位整数、0~4位小数，每16个中有一个7或8位有效数字。
+static void random_number(char *buf)
+{
+  uint32_t r = random_next();
+  uint8_t decimals = r % 5;
+  uint8_t digits = 1 + (r >> 3) % 4;
+  if (((r >> 6) & 15) == 0) { decimals = 4; digits = 3 + (r >> 10) % 2; }
+  char *p = buf;
+  if (r & (1UL << 12)) { *p++ = '-'; }
+  uint8_t idx;
+  for (idx=0; idx<digits; idx++) { *p++ = '0' + random_next() % 10; }
+  if (decimals) {
+    *p++ = '.';
+    for (idx=0; idx<decimals; idx++) { *p++ = '0' + random_next() % 10; }
+  }
+  *p = 0;
+}
+
+
+static uint32_t fuzz()
+{
+  static const char alphabet[] = "0123456789012345678901234567890123456789..--++XYZ ";
+  char line[32];
+  uint32_t count, mismatch = 0;
+  for (count=0; count<FUZZ_COUNT; count++) {
+    uint8_t length = random_next() % 24;
+    uint8_t idx;
+    for (idx=0; idx<length; idx++) { line[idx] = alphabet[random_next() % (sizeof(alphabet)-1)]; }
+    line[length] = 0;
+    uint8_t start = length ? random_next() % length : 0;
+    uint8_t counter_a = start, counter_b = start;
+    float value_a = 0, value_b = 0;
+    uint8_t ok_a = read_float_original(line, &counter_a, &value_a);
+    uint8_t ok_b = read_float(line, &counter_b, &value_b);
+    uint8_t wrong = false;
+    if (ok_b) {
+      char number[32];
+      memcpy(number, line+start, counter_b-start);
+      number[counter_b-start] = 0;
+      uint8_t digits = strlen(number) - strspn(number, "+-") - (strchr(number, '.') != NULL);
+      if (digits <= MAX_INT_DIGITS) {
+        wrong = (ulp_distance(value_b, strtof(number, NULL)) > (digits == MAX_INT_DIGITS));
+      }
+    }
+    if ((ok_a != ok_b) || (counter_a != counter_b) || wrong) {
+      if (mismatch++ < 10) {
+        printf("mismatch \"%s\"+%u: original %u %u %.9g, new %u %u %.9g\n",
+               line, start, ok_a, counter_a, value_a, ok_b, counter_b, value_b);
+      }
+    }
+  }
+  printf("fuzz      %u strings, %u mismatches\n", FUZZ_COUNT, mismatch);
+  return(mismatch);
+}
+
+
+static void accuracy(const char *name, read_float_t function)
+{
+  char line[32];
+  uint32_t count, inexact = 0, worst = 0;
+  random_state = 12345;
+  for (count=0; count<ACCURACY_COUNT; count++) {
+    random_number(line);
+    uint8_t counter = 0;
+    float value;
+    function(line, &counter, &value);
+    uint32_t distance = ulp_distance(value, strtof(line, NULL));
+    if (distance) { inexact++; }
+    if (distance > worst) { worst = distance; }
+  }
+  printf("accuracy  %-9s %6.2f%% not correctly rounded, worst %u ulp\n", name, 100.0*inexact/ACCURACY_COUNT, worst);
+}
+
+
+static double speed(read_float_t function, char (*numbers)[16])
+{
+  double best = 0;
+  volatile float sink;
+  uint8_t run;
+  for (run=0; run<SPEED_RUNS; run++) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint32_t count;
+    for (count=0; count<SPEED_COUNT; count++) {
+      uint8_t counter = 0;
+      float value;
+      function(numbers[count], &counter, &value);
+      sink = value;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double ns = ((end.tv_sec-start.tv_sec)*1e9 + (end.tv_nsec-start.tv_nsec))/SPEED_COUNT;
+    if ((run == 0) || (ns < best)) { best = ns; }
+  }
+  (void)sink;
+  return(best);
+}
+
+
+int main()
+{
+  uint32_t mismatch = fuzz();
+
+  accuracy("original", read_float_original);
+  accuracy("new", read_float);
+
+  char (*numbers)[16] = malloc(SPEED_COUNT*sizeof(*numbers));
+  if (numbers == NULL) { perror("readfloat"); exit(1); }
+  random_state = 54321;
+  uint32_t count;
+  for (count=0; count<SPEED_COUNT; count++) { random_number(numbers[count]); }
+  double original_ns = speed(read_float_original, numbers);
+  double new_ns = speed(read_float, numbers);
+  printf("speed     original %.2f ns/call, new %.2f ns/call\n", original_ns, new_ns);
+  free(numbers);
+
+  return(mismatch ? 1 : 0);
+}
@@ -0,0 +1,263 @@
+/*
+  replay.c - 在主机上重放G代码：经过真实的解析器、规划器和段准备，计算加工时间
+  Grbl仿真的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+/*
+  与bench.c相同，这里没有步进中断：每当mc_line()等待规划器缓冲区时，protocol_execute_realtime()的替身
+  把段缓冲区中的段全部取走，再重新准备，直到规划器有空位。段的步数乘以每步的周期就是加工时间，
+  与机器上运行时段准备计算的速度剖面完全相同，只是不包括串口传输和主循环的延迟。
+
+  planner.c和stepper.c直接包含进本文件，以便访问规划器缓冲区的索引和段缓冲区。段准备完成一个块时调用的
+  plan_discard_current_block()换成replay_discard_current_block()，由此知道每个段属于哪个块。
+*/
+
+#include <stdio.h>
+#include "planner.c"
+static void replay_discard_current_block();
+#define plan_discard_current_block() replay_discard_current_block()
+#include "stepper.c"
+#undef plan_discard_current_block
+#include "replay.h"
+#include "sim.h"
+
+replay_result_t replay_result;
+void (*replay_block_hook)(replay_block_t *block);
+void (*replay_segment_hook)(uint32_t block_id, uint32_t steps, uint32_t cycles);
+
+static uint8_t replay_head;       // 上次统计时的规划器缓冲头
+static uint32_t replay_updates;    // 加入或延长块的次数
+static uint32_t replay_wait_updates; // 上次执行运动时加入或延长块的次数
+static uint32_t replay_block_id[BLOCK_BUFFER_SIZE];     // 规划器缓冲区中每个块的序号
+static uint32_t replay_segment_block[SEGMENT_BUFFER_SIZE]; // 段缓冲区中每个段所属块的序号
+static segment_index_t replay_segment_mark; // 从这个段开始还没有记下所属的块
+#ifdef PLANNER_MERGE_COLLINEAR
+  static float replay_last_millimeters; // 上次报告时最后一个块的长度，变化说明有线段合并进来
+#endif
+
+
+// 把规划器缓冲区中的块报告给replay_block_hook。
+static void replay_report_block(uint8_t block_index)
+{
+  plan_block_t *block = &block_buffer[block_index];
+  replay_updates++;
+  #ifdef PLANNER_MERGE_COLLINEAR
+    replay_last_millimeters = block->millimeters;
+  #endif
+  if (replay_block_hook) {
+    replay_block_t info;
+    info.id = replay_block_id[block_index];
+    info.millimeters = block->millimeters;
+    info.programmed_rate = block->programmed_rate;
+    info.nominal_speed = plan_compute_profile_nominal_speed(block);
+    info.junction_speed = sqrt(min(block->max_junction_speed_sqr, info.nominal_speed*info.nominal_speed));
+    info.acceleration = block->acceleration;
+    info.step_event_count = block->step_event_count;
+    replay_block_hook(&info);
+  }
+}
+
+
+// 统计新加入规划器的块。每次加入块之前mc_line()都会调用protocol_execute_realtime()，所以缓冲头不会绕过一整圈。
+static void replay_count_blocks()
+{
+  #ifdef PLANNER_MERGE_COLLINEAR
+    // 两次统计之间最多加入或延长一个块，合并只延长不在尾部的最后一个块。尾部和已执行完的块长度会被段准备改变，不比较。
+    uint8_t last = plan_prev_block_index(replay_head);
+    if ((replay_head == block_buffer_head) && (block_buffer_head != block_buffer_tail) && (last != block_buffer_tail) &&
+        (block_buffer[last].millimeters != replay_last_millimeters)) {
+      replay_report_block(last);
+    }
+  #endif
+  while (replay_head != block_buffer_head) {
+    replay_block_id[replay_head] = replay_result.blocks;
+    replay_report_block(replay_head);
+    replay_result.blocks++;
+    replay_head = plan_next_block_index(replay_head);
+  }
+}
+
+
+// 记下新准备好的段属于块id。
+static void replay_assign_segments(uint32_t id)
+{
+  while (replay_segment_mark != segment_buffer_head) {
+    replay_segment_block[replay_segment_mark] = id;
+    if (++replay_segment_mark == SEGMENT_BUFFER_SIZE) { replay_segment_mark = 0; }
+  }
+}
+
+
+// 段准备完成了当前块，此前准备的段都属于它。
+static void replay_discard_current_block()
+{
+  replay_assign_segments(replay_block_id[block_buffer_tail]);
+  plan_discard_current_block();
+}
+
+
+// 代替步进中断：取走段缓冲区中所有已准备好的段。
+static void replay_consume_segments()
+{
+  while (segment_buffer_tail != segment_buffer_head) {
+    segment_t *segment = &segment_buffer[segment_buffer_tail];
+    replay_result.segments++;
+    #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+      uint32_t steps = segment->n_step >> segment->AMASS_level;
+      uint32_t cycles = (uint32_t)segment->n_step*segment->cycles_per_tick;
+    #else
+      uint32_t steps = segment->n_step;
+      uint32_t cycles = ((uint32_t)segment->n_step*segment->cycles_per_tick) << (3*(segment->prescaler-1));
+    #endif
+    replay_result.cycles += cycles;
+    if (replay_segment_hook) { replay_segment_hook(replay_segment_block[segment_buffer_tail], steps, cycles); }
+    segment_buffer_tail++;
+    if (segment_buffer_tail == SEGMENT_BUFFER_SIZE) { segment_buffer_tail = 0; }
+  }
+}
+
+
+// 执行缓冲区中的运动：all为false时只执行到规划器有空位，为true时全部执行完。
+// 调用者没有加入新块就再次调用时（例如mc_arc()等待多个空位），每次多执行完一个块。
+static void replay_run(uint8_t all)
+{
+  replay_count_blocks();
+  uint8_t free_blocks = 1;
+  if (replay_updates == replay_wait_updates) { free_blocks = min(plan_get_block_buffer_available()+1, BLOCK_BUFFER_SIZE-1); }
+  replay_wait_updates = replay_updates;
+  for (;;) {
+    replay_consume_segments();
+    if (!all && (plan_get_block_buffer_available() >= free_blocks)) { return; }
+    #ifdef PLANNER_DEFERRED_RECALCULATE
+      plan_recalculate_deferred();
+    #endif
+    if ((plan_get_current_block() == NULL) && (segment_buffer_tail == segment_buffer_head)) { return; }
+    st_prep_buffer();
+    // 其余的段属于还没有准备完的当前块
+    if (pl_block != NULL) { replay_assign_segments(replay_block_id[block_buffer_tail]); }
+  }
+}
+
+
+// protocol.c的替身
+void protocol_main_loop() { }
+void protocol_exec_rt_system() { }
+void protocol_auto_cycle_start() { }
+void protocol_execute_realtime() { replay_run(false); }
+void protocol_buffer_synchronize()
+{
+  #ifdef PATH_BLENDING
+    mc_blend_flush();
+  #endif
+  replay_run(true);
+}
+
+// serial.c的替身。Grbl的输出丢弃。
+void serial_init() { }
+void serial_write(uint8_t data) { }
+uint8_t serial_read() { return(SERIAL_NO_DATA); }
+void serial_reset_read_buffer() { }
+uint8_t serial_get_rx_buffer_available() { return(RX_BUFFER_SIZE); }
+uint8_t serial_get_rx_buffer_count() { return(0); }
+uint8_t serial_get_tx_buffer_count() { return(0); }
+
+// 中断和延时的替身。没有中断需要调度。
+void sim_sei() { SREG |= (1<<SREG_I); }
+void sim_cli() { SREG &= ~(1<<SREG_I); }
+void sim_delay_cycles(uint32_t cycles) { replay_result.dwell_cycles += cycles; }
+
+
+void replay_init(const char *eeprom_file)
+{
+  sim_eeprom_init(eeprom_file);
+  settings_init();
+  stepper_init();
+  system_init();
+}
+
+
+// 与grbl/main.c中每次复位时的初始化相同。
+void replay_start(uint8_t check_mode)
+{
+  memset(&sys, 0, sizeof(system_t));
+  sys.f_override = DEFAULT_FEED_OVERRIDE;
+  sys.r_override = DEFAULT_RAPID_OVERRIDE;
+  sys.spindle_speed_ovr = DEFAULT_SPINDLE_SPEED_OVERRIDE;
+  memset(sys_position, 0, sizeof(sys_position));
+  gc_init();
+  spindle_init();
+  coolant_init();
+  plan_reset();
+  #ifdef PATH_BLENDING
+    mc_blend_reset();
+  #endif
+  st_reset();
+  plan_sync_position();
+  gc_sync_position();
+  replay_head = block_buffer_head;
+  replay_updates = 0;
+  replay_wait_updates = 0;
+  replay_segment_mark = segment_buffer_head;
+  memset(&replay_result, 0, sizeof(replay_result)); // st_reset()中的空闲锁定延时不计入
+  // 段准备只在运行状态下进行，这里一开始就当作循环已启动。
+  if (check_mode) { sys.state = STATE_CHECK_MODE; }
+  else { sys.state = STATE_CYCLE; }
+}
+
+
+void replay_normalize(char *line)
+{
+  if (line[0] == '$') {
+    line[strcspn(line, "\r\n")] = 0;
+    return;
+  }
+  uint8_t comment = 0;
+  char *out = line;
+  char *c;
+  for (c = line; *c; c++) {
+    if ((*c == '\n') || (*c == '\r')) { break; }
+    if (comment) {
+      if ((*c == ')') && (comment == '(')) { comment = 0; }
+    } else if ((*c <= ' ') || (*c == '/')) {
+      // 丢弃空白字符，块删除不支持。
+    } else if ((*c == '(') || (*c == ';')) {
+      comment = *c;
+    } else if (*c >= 'a' && *c <= 'z') {
+      *out++ = *c-'a'+'A';
+    } else {
+      *out++ = *c;
+    }
+  }
+  *out = 0;
+}
+
+
+uint8_t replay_setting(char *line)
+{
+  if ((line[0] != '$') || (line[1] < '0') || (line[1] > '9') || (strchr(line, '=') == NULL)) { return(STATUS_INVALID_STATEMENT); }
+  return(system_execute_line(line));
+}
+
+
+uint8_t replay_line(char *line)
+{
+  if ((line[0] == 0) || (line[0] == '$')) { return(STATUS_OK); }
+  replay_result.lines++;
+  uint8_t status = gc_execute_line(line);
+  if (status != STATUS_OK) { replay_result.errors++; }
+  replay_count_blocks();
+  return(status);
+}
+
+
+void replay_finish()
+{
+  if (sys.state != STATE_CHECK_MODE) { protocol_buffer_synchronize(); }
+  replay_count_blocks();
+}
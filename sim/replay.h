@@ -0,0 +1,63 @@
+/*
+  replay.h - 在主机上重放G代码：经过真实的解析器、规划器和段准备，计算加工时间
+  Grbl仿真的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+#ifndef replay_h
+#define replay_h
+
+#include <stdint.h>
+
+typedef struct {
+  uint32_t lines;     // 送进gc_execute_line()的行数
+  uint32_t errors;    // 出错的行数
+  uint32_t blocks;    // 进入规划器的块数
+  uint32_t segments;  // 准备好的段数
+  uint64_t cycles;    // 所有段的执行时间（CPU周期），即加工时间
+  uint64_t dwell_cycles; // G4暂停的时间（CPU周期）
+} replay_result_t;
+extern replay_result_t replay_result;
+
+// 进入规划器的块。速度单位mm/min，加速度mm/min^2。
+typedef struct {
+  uint32_t id;              // 块的序号，从0开始
+  float millimeters;
+  float programmed_rate;    // 编程速度，快速运动为轴限制的最大速率
+  float nominal_speed;      // 受轴最大速率限制后的标称速度
+  float junction_speed;     // 与上一块之间的最大节点速度，从静止开始时为0
+  float acceleration;
+  uint32_t step_event_count;
+} replay_block_t;
+
+// 不为NULL时，每个块进入规划器后调用一次。块在产生它的replay_line()返回之前报告。
+// 启用PLANNER_MERGE_COLLINEAR时，块被后面的线段延长后会以相同的序号再报告一次。
+extern void (*replay_block_hook)(replay_block_t *block);
+
+// 不为NULL时，每个段执行时调用一次：所属块的序号、步数（去掉AMASS倍数）和执行时间（CPU周期）。
+extern void (*replay_segment_hook)(uint32_t block_id, uint32_t steps, uint32_t cycles);
+
+// 初始化设置。file不为NULL时从EEPROM文件（grbl-sim -e保存的格式）加载机器的$设置，否则使用默认值。
+void replay_init(const char *eeprom_file);
+
+// 复位解析器、规划器和段准备，开始一次新的重放。check_mode为true时与$C相同，只解析不运动。
+void replay_start(uint8_t check_mode);
+
+// 按protocol_main_loop()的规则整理一行：去掉空白和注释，字母改成大写。'$'开头的行原样保留。
+void replay_normalize(char *line);
+
+// 执行一行整理过的'$'设置命令（$x=值），改变后面重放使用的机器设置。其它'$'命令返回STATUS_INVALID_STATEMENT。
+uint8_t replay_setting(char *line);
+
+// 执行一行整理过的G代码，返回状态码。空行和'$'系统命令不执行，返回STATUS_OK。
+uint8_t replay_line(char *line);
+
+// 执行完缓冲区中的所有运动。
+void replay_finish();
+
+#endif
@@ -0,0 +1,443 @@
+/*
+  sim.c - 主机仿真的虚拟时钟和中断调度
+  Grbl仿真的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+/*
+  仿真原理：
+  grbl目录下的源文件用 -finstrument-functions 编译，主程序每进入一个函数都会调用 __cyg_profile_func_enter()，
+  这里把它当作主循环的“时钟节拍”：虚拟时钟前进 cycles_per_call 个周期，然后按时间顺序触发到期的中断。
+  grbl中所有的忙等待循环都会调用函数（protocol_execute_realtime()等），所以不会卡死，整个仿真是单线程、确定性的。
+
+  定时器和串口都根据寄存器的值建模：
+  - TIMER1_COMPA_vect：CTC模式，TIMSK1的OCIE1A使能，周期为(OCR1A+1)*预分频。
+  - TIMER0_OVF_vect：TCCR0B开始计数时从TCNT0计到256溢出。
+  - SERIAL_RX：按波特率间隔把G代码字节写入UDR0并调用接收中断，接收缓冲区满时暂停（相当于上位机的字符计数流控）。
+  - SERIAL_UDRE：UDRIE0置位时立即调用，取走UDR0中的字节作为Grbl的输出。
+  中断服务程序的执行不消耗虚拟时间，步进端口的变化以中断的触发时刻记录到跟踪文件。
+*/
+
+#include <stdlib.h>
+#include "grbl.h"
+#include "sim.h"
+
+// grbl中定义的中断服务程序
+void TIMER1_COMPA_vect(void);
+void TIMER0_OVF_vect(void);
+void SERIAL_RX(void);
+void SERIAL_UDRE(void);
+
+extern volatile uint8_t serial_rx_buffer_tail; // serial.c
+
+sim_config_t sim_config = { 40, 115200, 0.0, 1, NULL, 0, NULL };
+
+// 定时器预分频，下标为CSn2:0
+static const uint16_t sim_prescale[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+
+typedef struct {
+  uint8_t armed;   // 定时器正在计数
+  uint8_t latched; // 到期时全局中断被关闭，中断标志挂起
+  uint64_t next;   // 下一次中断时刻
+} sim_timer_t;
+
+static struct {
+  uint64_t now;         // 虚拟时钟，单位CPU周期
+  uint8_t busy;         // 防止仿真器自身调用grbl函数时重入
+  uint8_t dispatching;  // 正在调度中断
+  uint64_t next_event;  // 最近一个中断的时刻，在此之前寄存器不变时主循环节拍走快速路径
+  uint64_t regs;        // 上次调度结束时相关寄存器的快照
+  uint8_t rx_tail;      // 上次调度结束时的接收缓冲区尾指针，主程序取走数据后可以继续发送
+  uint32_t isr_count;   // 已执行的会影响主循环的中断次数（不含步进脉冲复位中断）
+  uint32_t idle_isr_count; // 上一次进入st_prep_buffer()时的中断次数
+  sim_timer_t t1, t0;
+
+  int rx_byte;          // 下一个待发送的G代码字节，-1表示输入结束
+  uint8_t rx_blocked;   // 接收缓冲区已满，等待Grbl取走数据
+  uint64_t rx_next;     // 下一个字节到达时刻
+  uint32_t rx_cycles;   // 每个字节的传输时间
+  int rx_last;          // 上一个送出的字节
+  uint8_t rx_ready;     // 已收到Grbl的欢迎信息。在此之前送出的数据会被serial_reset_read_buffer()丢弃。
+  uint8_t rx_frame;     // 正在发送的二进制块帧还剩的字节数。帧内的字节原样发送。
+
+  uint32_t lines_sent;  // 已送出的行数
+  uint32_t responses;   // 收到的 ok/error 数
+  uint32_t errors;
+  char tx_line[128];    // 正在接收的一行输出
+  uint8_t tx_len;
+
+  uint8_t step_bits;    // 当前逻辑步进位（按轴编号）
+  uint8_t dir_bits;     // 当前逻辑方向位（按轴编号）
+  uint32_t steps[N_AXIS];
+  uint64_t first_step;
+  uint64_t last_step;
+  uint32_t blocks;      // 步进中断开始执行的块数，用作跟踪中的块序号
+  int pulse_us;         // 跟踪中最近记录的$0
+} sim = { .rx_byte = -1, .rx_last = '\n', .pulse_us = -1 };
+
+static const uint8_t sim_step_pin[N_AXIS] = { X_STEP_BIT, Y_STEP_BIT, Z_STEP_BIT };
+static const uint8_t sim_dir_pin[N_AXIS] = { X_DIRECTION_BIT, Y_DIRECTION_BIT, Z_DIRECTION_BIT };
+
+
+uint64_t sim_time() { return(sim.now); }
+
+
+// 读取下一个G代码字节。去掉回车（二进制帧内除外），并保证最后一行以换行结尾。
+static void sim_rx_fetch()
+{
+  int c;
+  do { c = (sim_config.gcode == NULL) ? EOF : getc(sim_config.gcode); } while ((c == '\r') && !sim.rx_frame);
+  if (c == EOF) {
+    c = (sim.rx_last == '\n') ? -1 : '\n';
+    sim_config.gcode = NULL;
+  }
+  sim.rx_byte = c;
+}
+
+
+// 比较步进/方向端口，变化时写入跟踪文件并统计步数。
+static void sim_trace_ports()
+{
+  uint8_t step_bits = 0, dir_bits = 0;
+  uint8_t idx;
+  for (idx=0; idx<N_AXIS; idx++) {
+    if ((STEP_PORT >> sim_step_pin[idx]) & 1) { step_bits |= bit(idx); }
+    if ((DIRECTION_PORT >> sim_dir_pin[idx]) & 1) { dir_bits |= bit(idx); }
+  }
+  step_bits ^= settings.step_invert_mask;
+  dir_bits ^= settings.dir_invert_mask;
+  if ((step_bits == sim.step_bits) && (dir_bits == sim.dir_bits)) { return; }
+
+  uint8_t rising = step_bits & ~sim.step_bits;
+  if (rising) {
+    for (idx=0; idx<N_AXIS; idx++) {
+      if (rising & bit(idx)) { sim.steps[idx]++; }
+    }
+    if (sim.first_step == 0) { sim.first_step = sim.now; }
+    sim.last_step = sim.now;
+  }
+  sim.step_bits = step_bits;
+  sim.dir_bits = dir_bits;
+  if (sim_config.trace) {
+    fprintf(sim_config.trace, "%llu %x %x\n", (unsigned long long)sim.now, step_bits, dir_bits);
+  }
+}
+
+
+void sim_trace_segment(uint8_t new_block, uint16_t n_step, uint8_t amass_level)
+{
+  if (!sim_config.trace || !sim_config.trace_segments) { return; }
+  sim_trace_ports(); // 先记下本次中断输出的上一段的最后一步
+  if (settings.pulse_microseconds != sim.pulse_us) {
+    sim.pulse_us = settings.pulse_microseconds;
+    fprintf(sim_config.trace, "# settings pulse_us=%d\n", sim.pulse_us);
+  }
+  if (new_block) { sim.blocks++; }
+  uint32_t period = ((uint32_t)OCR1A+1)*sim_prescale[TCCR1B & 0x07];
+  fprintf(sim_config.trace, "s %llu %u %u %u %u\n", (unsigned long long)sim.now, sim.blocks, n_step, period, amass_level);
+}
+
+
+// Grbl输出一个字节。按行统计 ok/error 应答。
+static void sim_tx_byte(uint8_t data)
+{
+  if (sim_config.echo) { putchar(data); }
+  if (data == '\n') {
+    sim.tx_line[sim.tx_len] = 0;
+    if (strncmp(sim.tx_line, "Grbl ", 5) == 0) {
+      if (!sim.rx_ready) { sim.rx_ready = true; sim.rx_next = sim.now; }
+    }
+    else if (sim.rx_ready) {
+      if (strncmp(sim.tx_line, "ok", 2) == 0) { sim.responses++; }
+      else if (strncmp(sim.tx_line, "error", 5) == 0) { sim.responses++; sim.errors++; }
+      else if (strncmp(sim.tx_line, "[ACK:", 5) == 0) {
+        sim.responses++;
+        if (strchr(sim.tx_line, ',')) { sim.errors++; }
+      }
+      else if (strncmp(sim.tx_line, "[NAK:", 5) == 0) { sim.responses++; sim.errors++; } // 仿真不重发，之后的帧也不会应答
+    }
+    sim.tx_len = 0;
+  } else if ((data != '\r') && (sim.tx_len < sizeof(sim.tx_line)-1)) {
+    sim.tx_line[sim.tx_len++] = data;
+  }
+}
+
+
+// 根据寄存器的当前值启动或停止定时器。
+static void sim_timers_update()
+{
+  uint16_t prescale = sim_prescale[TCCR1B & 0x07];
+  if ((TIMSK1 & (1<<OCIE1A)) && prescale) {
+    if (!sim.t1.armed) {
+      sim.t1.armed = true;
+      sim.t1.latched = false;
+      sim.t1.next = sim.now + ((uint32_t)OCR1A+1)*prescale;
+    }
+  } else {
+    sim.t1.armed = false;
+  }
+
+  prescale = sim_prescale[TCCR0B & 0x07];
+  if (prescale) {
+    if (!sim.t0.armed) {
+      sim.t0.armed = true;
+      sim.t0.latched = false;
+      sim.t0.next = sim.now + (256-(uint32_t)TCNT0)*prescale;
+    }
+  } else {
+    sim.t0.armed = false;
+  }
+}
+
+
+// 主循环可能改变的、影响中断调度的寄存器。
+static uint64_t sim_registers()
+{
+  return( ((uint64_t)SREG << 56) | ((uint64_t)TIMSK1 << 48) | ((uint64_t)TCCR1B << 40) | ((uint64_t)TIMSK0 << 32) |
+          ((uint64_t)TCCR0B << 24) | ((uint64_t)UCSR0B << 16) | ((uint64_t)STEP_PORT << 8) | DIRECTION_PORT );
+}
+
+
+// 记录下一个中断时刻和寄存器快照。
+static void sim_schedule()
+{
+  sim.next_event = UINT64_MAX;
+  if (sim.t1.latched || sim.t0.latched || !(SREG & (1<<SREG_I))) { sim.next_event = 0; }
+  if (sim.t1.armed && (sim.t1.next < sim.next_event)) { sim.next_event = sim.t1.next; }
+  if (sim.t0.armed && (sim.t0.next < sim.next_event)) { sim.next_event = sim.t0.next; }
+  if (sim.rx_ready && (sim.rx_byte >= 0)) {
+    if (!sim.rx_blocked && (sim.rx_next < sim.next_event)) { sim.next_event = sim.rx_next; }
+  }
+  if (sim.rx_byte < 0) { sim.next_event = 0; } // 输入结束后每个节拍都检查是否完成
+  sim.regs = sim_registers();
+  sim.rx_tail = serial_rx_buffer_tail;
+}
+
+
+// 以中断的方式调用一个中断服务程序。硬件进入中断时清除I位，RETI时恢复。
+static void sim_isr(void (*vector)(void), uint64_t time)
+{
+  uint64_t now = sim.now;
+  sim.now = time;
+  SREG &= ~(1<<SREG_I);
+  vector();
+  if (vector != TIMER0_OVF_vect) { sim.isr_count++; }
+  SREG |= (1<<SREG_I);
+  sim_timers_update();
+  sim_trace_ports();
+  sim.now = now;
+}
+
+
+// 按时间顺序（同时到期时按AVR中断向量优先级）触发所有到期的中断。
+static void sim_dispatch()
+{
+  if (sim.dispatching) { return; }
+  sim.dispatching = true;
+  for (;;) {
+    sim_timers_update();
+
+    uint8_t enabled = SREG & (1<<SREG_I);
+    uint8_t t1_due = sim.t1.armed && (sim.t1.next <= sim.now);
+    uint8_t t0_due = sim.t0.armed && (sim.t0.next <= sim.now);
+    if (!enabled) {
+      // 中断标志挂起，等全局中断重新打开后在当时立即执行。
+      if (t1_due) { sim.t1.latched = true; }
+      if (t0_due) { sim.t0.latched = true; }
+      break;
+    }
+
+    uint8_t rx_due = false;
+    if (sim.rx_ready && (sim.rx_byte >= 0) && (UCSR0B & (1<<RXCIE0))) {
+      uint8_t rx_needed = 1;
+      #ifdef BINARY_STREAMING
+        // 上位机按窗口发送：接收缓冲区放得下整帧才开始发送一帧，否则Grbl会丢弃整帧。
+        if ((sim.rx_frame == 0) && (sim.rx_byte == CMD_BINARY_BLOCK)) { rx_needed = BINARY_FRAME_SIZE+1; }
+      #endif
+      if (serial_get_rx_buffer_available() < rx_needed) {
+        sim.rx_blocked = true;
+      } else {
+        if (sim.rx_blocked) {
+          sim.rx_blocked = false;
+          sim.rx_next = sim.now + sim.rx_cycles;
+        }
+        rx_due = (sim.rx_next <= sim.now);
+      }
+    }
+
+    uint64_t t1_time = sim.t1.latched ? sim.now : sim.t1.next;
+    uint64_t t0_time = sim.t0.latched ? sim.now : sim.t0.next;
+
+    if (t1_due && (!t0_due || (t1_time <= t0_time)) && (!rx_due || (t1_time <= sim.rx_next))) {
+      sim.t1.latched = false;
+      sim_isr(TIMER1_COMPA_vect, t1_time);
+      // CTC模式：计数器在比较匹配时清零，新的OCR1A从本次匹配开始生效。
+      if (sim.t1.armed) {
+        uint32_t period = ((uint32_t)OCR1A+1)*sim_prescale[TCCR1B & 0x07];
+        sim.t1.next = t1_time + period;
+        while (sim.t1.next <= t1_time) { sim.t1.next += period; }
+      }
+    } else if (t0_due && (!rx_due || (t0_time <= sim.rx_next))) {
+      sim.t0.latched = false;
+      TCNT0 = 0;
+      if (TIMSK0 & (1<<TOIE0)) { sim_isr(TIMER0_OVF_vect, t0_time); }
+      if (sim.t0.armed) { sim.t0.next = t0_time + 256*(uint32_t)sim_prescale[TCCR0B & 0x07]; }
+    } else if (rx_due) {
+      uint64_t time = sim.rx_next;
+      UDR0 = sim.rx_byte;
+      if (sim.rx_frame) { sim.rx_frame--; }
+      #ifdef BINARY_STREAMING
+        else if (sim.rx_byte == CMD_BINARY_BLOCK) { sim.rx_frame = BINARY_FRAME_SIZE; sim.lines_sent++; }
+      #endif
+      else if (sim.rx_byte == '\n') { sim.lines_sent++; }
+      sim.rx_last = sim.rx_byte;
+      sim_isr(SERIAL_RX, time);
+      sim.rx_next = time + sim.rx_cycles;
+      sim_rx_fetch();
+    } else if (UCSR0B & (1<<UDRIE0)) {
+      sim_isr(SERIAL_UDRE, sim.now);
+      sim_tx_byte(UDR0);
+    } else {
+      break;
+    }
+  }
+  sim_schedule();
+  sim.dispatching = false;
+}
+
+
+// 输入已全部送出、全部行都已应答、运动全部完成后结束仿真。
+static void sim_check_done()
+{
+  if (sim.rx_byte >= 0) { return; }
+  if (sim.responses < sim.lines_sent) { return; }
+  if (plan_get_current_block() != NULL) { return; }
+  if ((sys.state != STATE_IDLE) && (sys.state != STATE_ALARM)) { return; }
+  if (TIMSK1 & (1<<OCIE1A)) { return; }
+  if (UCSR0B & (1<<UDRIE0)) { return; }
+  sim_finish(0);
+}
+
+
+// 主循环空转跳过：两次进入st_prep_buffer()之间没有发生任何中断，说明段缓冲区已满或没有可执行的块。
+// 如果此时也没有待处理的串口数据和实时命令，主循环在下一个中断之前只会重复同样的空转，
+// 直接把虚拟时钟拨到下一个中断时刻。这不影响步进时序，只是省去空转的仿真开销。
+static void sim_skip_idle()
+{
+  if (sim.isr_count != sim.idle_isr_count) {
+    sim.idle_isr_count = sim.isr_count;
+    return;
+  }
+  if (sys_rt_exec_state || sys_rt_exec_alarm || sys_rt_exec_motion_override || sys_rt_exec_accessory_override) { return; }
+  if (serial_get_rx_buffer_count() && !plan_check_full_buffer()) { return; }
+  if (UCSR0B & (1<<UDRIE0)) { return; }
+
+  uint64_t next = UINT64_MAX;
+  if (sim.t1.armed && (sim.t1.next < next)) { next = sim.t1.next; }
+  if (sim.t0.armed && (sim.t0.next < next)) { next = sim.t0.next; }
+  if (sim.rx_ready && (sim.rx_byte >= 0) && !sim.rx_blocked && (sim.rx_next < next)) { next = sim.rx_next; }
+  if ((next != UINT64_MAX) && (next > sim.now+sim_config.cycles_per_call)) {
+    sim.now = next-sim_config.cycles_per_call;
+  }
+}
+
+
+void sim_advance(uint32_t cycles)
+{
+  sim.now += cycles;
+  sim_dispatch();
+}
+
+
+void sim_poll()
+{
+  if (sim.busy || sim.dispatching) { return; }
+  sim.now += sim_config.cycles_per_call;
+  if ((sim.now < sim.next_event) && (sim_registers() == sim.regs) && (serial_rx_buffer_tail == sim.rx_tail)) { return; }
+  sim.busy = true;
+  sim_trace_ports();
+  sim_dispatch();
+  if ((sim_config.time_limit > 0.0) && (sim.now > sim_config.time_limit*F_CPU)) {
+    fprintf(stderr, "[sim] time limit reached\n");
+    sim_finish(2);
+  }
+  sim_check_done();
+  sim.busy = false;
+}
+
+
+void sim_sei()
+{
+  SREG |= (1<<SREG_I);
+  sim_timers_update();
+  sim_dispatch();
+}
+
+
+void sim_cli()
+{
+  SREG &= ~(1<<SREG_I);
+}
+
+
+void sim_delay_cycles(uint32_t cycles)
+{
+  uint8_t busy = sim.busy;
+  sim.busy = true;
+  sim_trace_ports(); // 延时之前的端口变化按当前时刻记录。st_go_idle()在步进中断里延时，最后一步的脉冲在延时之前已经输出。
+  sim_advance(cycles);
+  sim.busy = busy;
+}
+
+
+void sim_start()
+{
+  sim.rx_cycles = (uint32_t)((10ULL*F_CPU)/sim_config.baud); // 8N1，每字节10位
+  sim_rx_fetch();
+  if (sim_config.trace) {
+    fprintf(sim_config.trace, "# grbl-sim trace f_cpu=%lu axes=%d\n", (unsigned long)F_CPU, N_AXIS);
+  }
+}
+
+
+void sim_finish(int status)
+{
+  uint8_t idx;
+  double seconds = (double)sim.now/F_CPU;
+  fflush(stdout);
+  fprintf(stderr, "[sim] lines: %u ok: %u error: %u\n", sim.lines_sent, sim.responses-sim.errors, sim.errors);
+  fprintf(stderr, "[sim] total time: %.6f s (%llu cycles)\n", seconds, (unsigned long long)sim.now);
+  fprintf(stderr, "[sim] motion time: %.6f s\n", (double)(sim.last_step-sim.first_step)/F_CPU);
+  fprintf(stderr, "[sim] steps:");
+  for (idx=0; idx<N_AXIS; idx++) { fprintf(stderr, " %c%u", "XYZ"[idx], sim.steps[idx]); }
+  fprintf(stderr, "\n");
+  #ifdef REPORT_SEGMENT_UNDERRUNS
+    fprintf(stderr, "[sim] segment underruns: %u\n", st_get_segment_underruns());
+  #endif
+  if (sim_config.trace) { fclose(sim_config.trace); }
+  exit(status);
+}
+
+
+// 由 -finstrument-functions 在grbl每个函数入口插入的调用。仿真器自身的文件不插桩。
+void __cyg_profile_func_enter(void *func, void *caller) __attribute__((no_instrument_function));
+void __cyg_profile_func_exit(void *func, void *caller) __attribute__((no_instrument_function));
+
+void __cyg_profile_func_enter(void *func, void *caller)
+{
+  if ((func == (void *)st_prep_buffer) && !sim.busy && !sim.dispatching) {
+    sim.busy = true;
+    sim_skip_idle();
+    sim.busy = false;
+  }
+  sim_poll();
+}
+
+void __cyg_profile_func_exit(void *func, void *caller)
+{
+}
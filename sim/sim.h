@@ -0,0 +1,51 @@
+/*
+  sim.h - 主机仿真的虚拟时钟和中断调度
+  Grbl仿真的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+#ifndef sim_h
+#define sim_h
+
+#include <stdint.h>
+#include <stdio.h>
+
+// 仿真运行参数，由main.c从命令行填写。
+typedef struct {
+  uint32_t cycles_per_call; // 主程序每进入一个函数消耗的虚拟CPU周期数（粗略的主循环开销模型）
+  uint32_t baud;            // 串口波特率，决定G代码字节送入接收中断的间隔
+  double time_limit;        // 虚拟时间上限，单位秒。0表示不限制。
+  uint8_t echo;             // 是否把Grbl的串口输出打印到stdout
+  FILE *trace;              // 步进/方向跟踪输出，NULL表示不输出
+  uint8_t trace_segments;   // 在跟踪中记录段和块的边界
+  FILE *gcode;              // G代码输入
+} sim_config_t;
+extern sim_config_t sim_config;
+
+// 初始化虚拟时钟和串口输入，在调用grbl主程序前执行。
+void sim_start();
+
+// 当前虚拟时间，单位CPU周期（F_CPU）。中断服务程序内为该中断的触发时刻。
+uint64_t sim_time();
+
+// 推进虚拟时钟，期间按时间顺序触发到期的中断。
+void sim_advance(uint32_t cycles);
+
+// 由grbl主循环每次函数调用驱动，参见sim.c中的__cyg_profile_func_enter。
+void sim_poll();
+
+// 初始化EEPROM，file不为NULL时从文件加载并在退出时写回。
+void sim_eeprom_init(const char *file);
+
+// 步进中断装载段时调用（grbl编译时-DST_SEGMENT_HOOK=sim_trace_segment）。
+void sim_trace_segment(uint8_t new_block, uint16_t n_step, uint8_t amass_level);
+
+// 打印仿真统计并退出。
+void sim_finish(int status);
+
+#endif
@@ -0,0 +1,330 @@
+/*
+  steptrace.c - 步进中断的回归测试：把随机的块和段送进TIMER1_COMPA_vect()，逐个中断与参照的Bresenham模型比较
+  Grbl仿真的一部分
+
+  Grbl 是自由软件：你可以在自由软件基金会的GNU 普通公共许可(GPL v3+)条款下发行，或修改它。
+  Grbl的发布是希望它能有用，但没有任何保证;甚至没有隐含的保证适销性或适合某一特定目的。
+  更多详细信息，请参阅GNU通用公共许可证。
+
+  您应该已经收到GNU通用公共许可证的副本和Grbl一起。如果没有，请参阅<http://www.gnu.org/licenses/>。
+*/
+
+/*
+  不经过规划器和段准备，直接填写st_block_buffer[]和segment_buffer[]，然后反复调用步进中断。
+  参照模型是Grbl 1.1h中手写的X、Y、Z三份Bresenham更新，按轴索引写成循环：
+    新块开始时所有计数器置为step_event_count/2；每个中断每个轴的计数器加上（按AMASS级别右移的）步数，
+    超过step_event_count时输出一步、减去step_event_count，并按方向位更新机器位置。
+  每个中断之后比较st.step_outbits和sys_position[]，输出不一致的个数和步进位序列的校验和。
+  块的步数、方向、段的步事件数和AMASS级别都是随机的，同一个块跨多个段，用来覆盖计数器在段之间的延续。
+
+  stepper.c直接包含进本文件，以便访问段缓冲区等静态变量。中断的主机耗时只适合比较改动前后，不代表AVR上的周期数。
+*/
+
+// grbl/main.c 的 main() 在编译时被改名为 grbl_main()（-Dmain=grbl_main），这里恢复真正的入口。
+#undef main
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <math.h>
+#include "planner.c"
+#include "stepper.c"
+#include "sim.h"
+
+#define TEST_BLOCKS 50000
+#define MAX_SEGMENTS_PER_BLOCK 4
+#define MAX_SEGMENT_STEPS 300
+#define MAX_BLOCK_EVENTS 100000
+
+#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+  #define STEP_SHIFT MAX_AMASS_LEVEL // 与st_prep_buffer()中的左移相同
+#else
+  #define STEP_SHIFT 1
+#endif
+
+// protocol.c的替身
+void protocol_main_loop() { }
+void protocol_exec_rt_system() { }
+void protocol_auto_cycle_start() { }
+void protocol_execute_realtime() { }
+void protocol_buffer_synchronize() { }
+
+// serial.c的替身
+void serial_init() { }
+void serial_write(uint8_t data) { }
+uint8_t serial_read() { return(SERIAL_NO_DATA); }
+void serial_reset_read_buffer() { }
+uint8_t serial_get_rx_buffer_available() { return(RX_BUFFER_SIZE); }
+uint8_t serial_get_rx_buffer_count() { return(0); }
+uint8_t serial_get_tx_buffer_count() { return(0); }
+
+// 中断和延时的替身
+void sim_sei() { SREG |= (1<<SREG_I); }
+void sim_cli() { SREG &= ~(1<<SREG_I); }
+void sim_delay_cycles(uint32_t cycles) { }
+
+
+static uint32_t random_state = 1;
+
+static uint32_t random_next()
+{
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return(random_state);
+}
+
+
+// 参照模型
+typedef struct {
+  uint32_t counter[N_AXIS];
+  uint32_t steps[N_AXIS];
+  int32_t position[N_AXIS];
+} reference_t;
+
+static reference_t ref;
+static uint32_t mismatches, ticks, checksum;
+
+
+static void reference_tick(st_block_t *block, uint8_t *step_bits)
+{
+  uint8_t idx;
+  *step_bits = 0;
+  for (idx=0; idx<N_AXIS; idx++) {
+    ref.counter[idx] += ref.steps[idx];
+    if (ref.counter[idx] > block->step_event_count) {
+      *step_bits |= get_step_pin_mask(idx);
+      ref.counter[idx] -= block->step_event_count;
+      if (block->direction_bits & get_direction_pin_mask(idx)) { ref.position[idx]--; }
+      else { ref.position[idx]++; }
+    }
+  }
+}
+
+
+// 执行一个段的全部中断，逐个与参照模型比较。返回这些中断的主机耗时（纳秒）。
+static uint64_t run_segment(segment_index_t block_index, uint8_t new_block, uint8_t level, uint16_t n_step)
+{
+  st_block_t *block = &st_block_buffer[block_index];
+  uint8_t idx;
+  if (new_block) {
+    for (idx=0; idx<N_AXIS; idx++) { ref.counter[idx] = block->step_event_count >> 1; }
+  }
+  for (idx=0; idx<N_AXIS; idx++) { ref.steps[idx] = block->steps[idx] >> level; }
+
+  segment_t *segment = &segment_buffer[segment_buffer_head];
+  memset(segment, 0, sizeof(segment_t));
+  segment->n_step = n_step;
+  segment->cycles_per_tick = 1000;
+  segment->st_block_index = block_index;
+  #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+    segment->AMASS_level = level;
+  #endif
+  if (++segment_buffer_head == SEGMENT_BUFFER_SIZE) { segment_buffer_head = 0; }
+
+  //中断连续执行并记录输出，计时之后再与参照模型比较。
+  static uint8_t outbits[MAX_SEGMENT_STEPS];
+  static int32_t position[MAX_SEGMENT_STEPS][N_AXIS];
+  uint16_t tick;
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (tick=0; tick<n_step; tick++) {
+    TIMER1_COMPA_vect();
+    outbits[tick] = st.step_outbits ^ step_port_invert_mask;
+    memcpy(position[tick], sys_position, sizeof(sys_position));
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  uint64_t ns = (end.tv_sec-start.tv_sec)*1000000000ULL + (end.tv_nsec-start.tv_nsec);
+
+  for (tick=0; tick<n_step; tick++) {
+    uint8_t step_bits;
+    reference_tick(block, &step_bits);
+    uint8_t wrong = (outbits[tick] != step_bits);
+    for (idx=0; idx<N_AXIS; idx++) {
+      if (position[tick][idx] != ref.position[idx]) { wrong = true; }
+    }
+    if (wrong && (mismatches++ < 10)) {
+      printf("mismatch tick %u: step bits %02x, expected %02x\n", ticks, outbits[tick], step_bits);
+    }
+    checksum = (checksum*31) ^ outbits[tick];
+    ticks++;
+  }
+  return(ns);
+}
+
+
+#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+// 抖动测量：一个X、Y、Z步数比为1:0.7071:0.3183的块，以固定的步进速率按指定的AMASS级别执行。
+// 记录Y、Z每一步的时刻，统计步进间隔与理想间隔（主导轴间隔除以步数比）之差。
+#define JITTER_EVENTS 1000
+
+typedef struct {
+  double max_us;
+  double rms_us;
+  double max_percent; // 最大偏差占理想间隔的百分比
+} jitter_t;
+
+static jitter_t jitter_level(uint8_t level, double rate)
+{
+  const uint8_t axes[2] = { Y_AXIS, Z_AXIS };
+  const double ratio[2] = { 0.7071, 0.3183 };
+  jitter_t result = { 0, 0, 0 };
+
+  st_reset();
+  segment_index_t block_index = st_next_block_index(0);
+  st_block_t *block = &st_block_buffer[block_index];
+  memset(block, 0, sizeof(st_block_t));
+  block->steps[X_AXIS] = (uint32_t)JITTER_EVENTS << STEP_SHIFT;
+  uint8_t i;
+  for (i=0; i<2; i++) { block->steps[axes[i]] = (uint32_t)lround(JITTER_EVENTS*ratio[i]) << STEP_SHIFT; }
+  block->step_event_count = (uint32_t)JITTER_EVENTS << STEP_SHIFT;
+
+  segment_t *segment = &segment_buffer[segment_buffer_head];
+  memset(segment, 0, sizeof(segment_t));
+  segment->n_step = JITTER_EVENTS << level;
+  segment->cycles_per_tick = 1000; // 主机上不用，时刻按下面的tick_us计算
+  segment->st_block_index = block_index;
+  segment->AMASS_level = level;
+  if (++segment_buffer_head == SEGMENT_BUFFER_SIZE) { segment_buffer_head = 0; }
+
+  double tick_us = 1000000.0/(rate*(1 << level));
+  double last_us[2] = { -1, -1 };
+  double sum_sq = 0;
+  uint32_t count = 0;
+  uint32_t tick;
+  for (tick=0; tick<((uint32_t)JITTER_EVENTS << level); tick++) {
+    TIMER1_COMPA_vect();
+    uint8_t bits = st.step_outbits ^ step_port_invert_mask;
+    for (i=0; i<2; i++) {
+      if (!(bits & get_step_pin_mask(axes[i]))) { continue; }
+      double now_us = tick*tick_us;
+      if (last_us[i] >= 0) {
+        double ideal_us = (double)block->step_event_count/block->steps[axes[i]]*1000000.0/rate;
+        double error_us = fabs((now_us-last_us[i]) - ideal_us);
+        if (error_us > result.max_us) { result.max_us = error_us; }
+        if (100*error_us/ideal_us > result.max_percent) { result.max_percent = 100*error_us/ideal_us; }
+        sum_sq += error_us*error_us;
+        count++;
+      }
+      last_us[i] = now_us;
+    }
+  }
+  if (count) { result.rms_us = sqrt(sum_sq/count); }
+  return(result);
+}
+
+
+// 每个AMASS级别取其频率范围中间的步进速率，与同一速率不用AMASS（第0级）时比较。
+static void report_jitter()
+{
+  #ifdef AMASS_RUNTIME_CUTOFFS
+    double cutoff = settings.amass_cutoff;
+    uint8_t max_level = settings.amass_max_level;
+  #else
+    double cutoff = (double)F_CPU/AMASS_LEVEL1;
+    uint8_t max_level = MAX_AMASS_LEVEL;
+  #endif
+  printf("amass   step_hz    isr_hz   max_us   rms_us  max_%%  level0_max_us  level0_max_%%\n");
+  uint8_t level;
+  for (level=0; level<=max_level; level++) {
+    double rate = (level == 0) ? 1.5*cutoff : 0.75*cutoff/(1 << (level-1));
+    jitter_t amass = jitter_level(level, rate);
+    jitter_t plain = jitter_level(0, rate);
+    printf("%5u %9.1f %9.1f %8.1f %8.1f %6.1f %14.1f %13.1f\n", level, rate, rate*(1 << level),
+      amass.max_us, amass.rms_us, amass.max_percent, plain.max_us, plain.max_percent);
+  }
+}
+#endif
+
+
+static uint64_t run_blocks()
+{
+  random_state = 1;
+  mismatches = ticks = checksum = 0;
+  st_reset();
+  memset(sys_position, 0, sizeof(sys_position));
+  memset(&ref, 0, sizeof(ref));
+  sys.state = STATE_CYCLE;
+
+  uint64_t ns = 0;
+  segment_index_t block_index = 0;
+  uint32_t count;
+  uint8_t idx;
+  for (count=0; count<TEST_BLOCKS; count++) {
+    // 与st_prep_buffer()相同，块的步数左移STEP_SHIFT位，最长的轴等于步事件数。
+    block_index = st_next_block_index(block_index);
+    st_block_t *block = &st_block_buffer[block_index];
+    uint32_t events = 1 + random_next() % MAX_BLOCK_EVENTS;
+    uint8_t longest = random_next() % N_AXIS;
+    block->direction_bits = 0;
+    for (idx=0; idx<N_AXIS; idx++) {
+      uint32_t r = random_next();
+      uint32_t steps = events;
+      if (idx != longest) {
+        switch (r & 3) {
+          case 0: steps = 0; break;
+          case 1: steps = events - (r >> 2) % (1 + events/100); break; // 接近最长轴
+          default: steps = (r >> 2) % (events+1);
+        }
+      }
+      block->steps[idx] = steps << STEP_SHIFT;
+      if (r & (1UL << 31)) { block->direction_bits |= get_direction_pin_mask(idx); }
+    }
+    block->step_event_count = events << STEP_SHIFT;
+
+    uint8_t segments = 1 + random_next() % MAX_SEGMENTS_PER_BLOCK;
+    uint8_t segment;
+    for (segment=0; segment<segments; segment++) {
+      uint8_t level = 0;
+      #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+        level = random_next() % (MAX_AMASS_LEVEL+1);
+      #endif
+      uint16_t n_step = 1 + random_next() % MAX_SEGMENT_STEPS;
+      ns += run_segment(block_index, (segment == 0), level, n_step);
+    }
+  }
+  return(ns);
+}
+
+
+int main(int argc, char *argv[])
+{
+  int repeats = (argc > 1) ? atoi(argv[1]) : 5;
+  if (repeats < 1) {
+    fprintf(stderr, "usage: %s [repeats [amass_cutoff_hz [amass_max_level]]]\n", argv[0]);
+    return(1);
+  }
+
+  sim_eeprom_init(NULL);
+  settings_init();
+  stepper_init();
+  system_init();
+
+  #ifdef AMASS_RUNTIME_CUTOFFS
+    // 与$38、$39相同的检查
+    if ((argc > 2) && (settings_store_global_setting(38, atof(argv[2])) != STATUS_OK)) {
+      fprintf(stderr, "invalid amass cutoff %s\n", argv[2]);
+      return(1);
+    }
+    if ((argc > 3) && (settings_store_global_setting(39, atof(argv[3])) != STATUS_OK)) {
+      fprintf(stderr, "invalid amass level %s\n", argv[3]);
+      return(1);
+    }
+  #endif
+
+  // 每次的随机序列相同，中断耗时取最快的一次。
+  uint64_t best_ns = UINT64_MAX;
+  int run;
+  for (run=0; run<repeats; run++) {
+    uint64_t ns = run_blocks();
+    if (ns < best_ns) { best_ns = ns; }
+    if (mismatches) { break; }
+  }
+
+  printf("steptrace %u blocks, %u interrupts, %u mismatches, checksum %08x\n", TEST_BLOCKS, ticks, mismatches, checksum);
+  printf("isr       %.2f ns/call\n", (double)best_ns/ticks);
+  #ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+    if (!mismatches) { report_jitter(); }
+  #endif
+  return(mismatches ? 1 : 0);
+}